@@ -0,0 +1,214 @@
+#include "Checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHECKSUM_X86
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHECKSUM_TARGET
+#else
+#define CHECKSUM_TARGET __attribute__((target("sse4.2")))
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define CHECKSUM_ARM
+#include <arm_acle.h>
+#endif
+
+namespace {
+    constexpr uint32_t Polynomial = 0x82f63b78;
+
+    constexpr std::array<std::array<uint32_t, 256>, 8> SliceTables = [] {
+        std::array<std::array<uint32_t, 256>, 8> tables{};
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t crc = n;
+            for (int k = 0; k < 8; k++)
+                crc = crc & 1 ? (crc >> 1) ^ Polynomial : crc >> 1;
+            tables[0][n] = crc;
+        }
+        for (uint32_t n = 0; n < 256; n++) {
+            for (size_t k = 1; k < 8; k++)
+                tables[k][n] = (tables[k - 1][n] >> 8) ^ tables[0][tables[k - 1][n] & 0xff];
+        }
+        return tables;
+    }();
+
+    uint64_t Load64(const unsigned char *data) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t UpdateSoftware(uint32_t crc, const unsigned char *data, size_t size) {
+        while (size >= 8) {
+            uint64_t word = Load64(data) ^ crc;
+            crc = SliceTables[7][word & 0xff] ^ SliceTables[6][(word >> 8) & 0xff] ^
+                  SliceTables[5][(word >> 16) & 0xff] ^ SliceTables[4][(word >> 24) & 0xff] ^
+                  SliceTables[3][(word >> 32) & 0xff] ^ SliceTables[2][(word >> 40) & 0xff] ^
+                  SliceTables[1][(word >> 48) & 0xff] ^ SliceTables[0][word >> 56];
+            data += 8;
+            size -= 8;
+        }
+
+        while (size-- > 0)
+            crc = (crc >> 8) ^ SliceTables[0][(crc ^ *data++) & 0xff];
+
+        return crc;
+    }
+
+#if defined(CHECKSUM_X86) || defined(CHECKSUM_ARM)
+    // The hardware path runs three independent streams to hide the latency of the crc instruction and merges them
+    // by shifting the earlier streams over StreamSize zero bytes.
+    constexpr size_t StreamSize = 8192;
+
+    struct ShiftTable {
+        uint32_t Table[4][256];
+
+        ShiftTable() {
+            uint32_t op[32];
+            ZerosOperator(op, StreamSize);
+            for (uint32_t n = 0; n < 256; n++) {
+                for (int k = 0; k < 4; k++)
+                    Table[k][n] = Multiply(op, n << (k * 8));
+            }
+        }
+
+        [[nodiscard]] uint32_t Shift(uint32_t crc) const {
+            return Table[0][crc & 0xff] ^ Table[1][(crc >> 8) & 0xff] ^ Table[2][(crc >> 16) & 0xff] ^
+                   Table[3][crc >> 24];
+        }
+
+        static uint32_t Multiply(const uint32_t *matrix, uint32_t vector) {
+            uint32_t sum = 0;
+            for (; vector != 0; vector >>= 1, matrix++) {
+                if (vector & 1)
+                    sum ^= *matrix;
+            }
+            return sum;
+        }
+
+        static void Square(uint32_t *square, const uint32_t *matrix) {
+            for (int n = 0; n < 32; n++)
+                square[n] = Multiply(matrix, matrix[n]);
+        }
+
+        // Builds the operator that appends length zero bytes, length must be a power of two
+        static void ZerosOperator(uint32_t *even, size_t length) {
+            uint32_t odd[32];
+            odd[0] = Polynomial;
+            for (int n = 1; n < 32; n++)
+                odd[n] = 1u << (n - 1);
+
+            Square(even, odd);
+            Square(odd, even);
+
+            do {
+                Square(even, odd);
+                length >>= 1;
+                if (length == 0)
+                    return;
+                Square(odd, even);
+                length >>= 1;
+            } while (length != 0);
+
+            std::memcpy(even, odd, sizeof(odd));
+        }
+    };
+
+    const ShiftTable &GetShiftTable() {
+        static const ShiftTable table;
+        return table;
+    }
+
+#ifdef CHECKSUM_X86
+    CHECKSUM_TARGET uint32_t Crc8(uint32_t crc, unsigned char value) { return _mm_crc32_u8(crc, value); }
+
+    CHECKSUM_TARGET uint64_t Crc64(uint64_t crc, uint64_t value) { return _mm_crc32_u64(crc, value); }
+#else
+    uint32_t Crc8(uint32_t crc, unsigned char value) { return __crc32cb(crc, value); }
+
+    uint64_t Crc64(uint64_t crc, uint64_t value) { return __crc32cd(static_cast<uint32_t>(crc), value); }
+#endif
+
+    CHECKSUM_TARGET uint32_t UpdateHardware(uint32_t crc, const unsigned char *data, size_t size) {
+        while (size > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0) {
+            crc = Crc8(crc, *data++);
+            size--;
+        }
+
+        if (size >= StreamSize * 3) {
+            const ShiftTable &shiftTable = GetShiftTable();
+            uint64_t crc0 = crc;
+
+            do {
+                uint64_t crc1 = 0;
+                uint64_t crc2 = 0;
+                const unsigned char *end = data + StreamSize;
+
+                do {
+                    crc0 = Crc64(crc0, Load64(data));
+                    crc1 = Crc64(crc1, Load64(data + StreamSize));
+                    crc2 = Crc64(crc2, Load64(data + StreamSize * 2));
+                    data += 8;
+                } while (data < end);
+
+                crc0 = shiftTable.Shift(static_cast<uint32_t>(crc0)) ^ static_cast<uint32_t>(crc1);
+                crc0 = shiftTable.Shift(static_cast<uint32_t>(crc0)) ^ static_cast<uint32_t>(crc2);
+
+                data += StreamSize * 2;
+                size -= StreamSize * 3;
+            } while (size >= StreamSize * 3);
+
+            crc = static_cast<uint32_t>(crc0);
+        }
+
+        uint64_t crc64 = crc;
+        while (size >= 8) {
+            crc64 = Crc64(crc64, Load64(data));
+            data += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+
+        while (size-- > 0)
+            crc = Crc8(crc, *data++);
+
+        return crc;
+    }
+#endif
+
+    using UpdateFunction = uint32_t (*)(uint32_t crc, const unsigned char *data, size_t size);
+
+    UpdateFunction SelectUpdate() {
+#if defined(CHECKSUM_X86) || defined(CHECKSUM_ARM)
+        if (Checksum::HasHardwareSupport())
+            return UpdateHardware;
+#endif
+        return UpdateSoftware;
+    }
+}
+
+uint32_t Checksum::Crc32c(const void *data, size_t size, uint32_t crc) {
+    static const UpdateFunction update = SelectUpdate();
+    return ~update(~crc, static_cast<const unsigned char *>(data), size);
+}
+
+uint32_t Checksum::Crc32cSoftware(const void *data, size_t size, uint32_t crc) {
+    return ~UpdateSoftware(~crc, static_cast<const unsigned char *>(data), size);
+}
+
+bool Checksum::HasHardwareSupport() {
+#if defined(CHECKSUM_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#elif defined(CHECKSUM_X86)
+    return __builtin_cpu_supports("sse4.2");
+#elif defined(CHECKSUM_ARM)
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli). Uses the SSE4.2 or ARMv8 CRC instructions when the CPU has them and a slice-by-8 table
+// otherwise; every path produces the same value.
+class Checksum {
+public:
+    static uint32_t Crc32c(const void *data, size_t size, uint32_t crc = 0);
+
+    static uint32_t Crc32cSoftware(const void *data, size_t size, uint32_t crc = 0);
+
+    static bool HasHardwareSupport();
+};
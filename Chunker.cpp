@@ -0,0 +1,64 @@
+#include "Chunker.h"
+
+#include <bit>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+    // The gear hash shifts left, so the high bits depend on the most input bytes
+    constexpr uint64_t HighBitMask(int bits) {
+        return bits <= 0 ? 0 : ~0ull << (64 - bits);
+    }
+}
+
+Chunker::Chunker(size_t minSize, size_t averageSize, size_t maxSize)
+        : minSize(minSize), averageSize(averageSize), maxSize(maxSize) {
+    if (minSize == 0 || minSize >= averageSize || averageSize >= maxSize)
+        throw std::runtime_error("Invalid chunk sizes");
+
+    // Normalized chunking: a stricter mask before the average size and a looser one after it keeps chunk sizes
+    // close to the average
+    int bits = static_cast<int>(std::bit_width(averageSize)) - 1;
+    smallMask = HighBitMask(bits + 2);
+    largeMask = HighBitMask(bits - 2);
+}
+
+size_t Chunker::NextChunk(const char *data, size_t size) const {
+    if (size <= minSize)
+        return size;
+
+    size = std::min(size, maxSize);
+    size_t normalSize = std::min(averageSize, size);
+
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data);
+    uint64_t hash = 0;
+    size_t i = minSize;
+
+    for (; i < normalSize; i++) {
+        hash = (hash << 1) + GearTable[bytes[i]];
+        if ((hash & smallMask) == 0)
+            return i + 1;
+    }
+
+    for (; i < size; i++) {
+        hash = (hash << 1) + GearTable[bytes[i]];
+        if ((hash & largeMask) == 0)
+            return i + 1;
+    }
+
+    return size;
+}
+
+std::vector<size_t> Chunker::Split(const char *data, size_t size) const {
+    std::vector<size_t> chunks;
+    chunks.reserve(size / averageSize + 1);
+
+    size_t offset = 0;
+    while (offset < size) {
+        size_t length = NextChunk(data + offset, size - offset);
+        chunks.push_back(length);
+        offset += length;
+    }
+
+    return chunks;
+}
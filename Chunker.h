@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Content-defined chunking with the FastCDC gear hash. Cut points depend only on nearby bytes, so an insertion
+// or append only changes the chunks around the edit.
+class Chunker {
+public:
+    static constexpr size_t DefaultMinSize = 4 * 1024;
+    static constexpr size_t DefaultAverageSize = 16 * 1024;
+    static constexpr size_t DefaultMaxSize = 64 * 1024;
+
+    explicit Chunker(size_t minSize = DefaultMinSize, size_t averageSize = DefaultAverageSize,
+                     size_t maxSize = DefaultMaxSize);
+
+    // Returns the length of the chunk starting at data
+    [[nodiscard]] size_t NextChunk(const char *data, size_t size) const;
+
+    [[nodiscard]] std::vector<size_t> Split(const char *data, size_t size) const;
+
+    [[nodiscard]] size_t getMinSize() const { return minSize; }
+
+    [[nodiscard]] size_t getAverageSize() const { return averageSize; }
+
+    [[nodiscard]] size_t getMaxSize() const { return maxSize; }
+
+private:
+    size_t minSize;
+    size_t averageSize;
+    size_t maxSize;
+
+    uint64_t smallMask;
+    uint64_t largeMask;
+
+    static constexpr std::array<uint64_t, 256> GearTable = [] {
+        std::array<uint64_t, 256> table{};
+        uint64_t state = 0;
+        for (auto &value: table) {
+            state += 0x9e3779b97f4a7c15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }();
+};
@@ -0,0 +1,99 @@
+#include "Cipher.h"
+
+#include <cstring>
+#include <stdexcept>
+#include "PackerConfig.h"
+
+#ifdef USE_ENCRYPTION
+#include "sodium.h"
+#endif
+
+bool Cipher::IsAvailable(PakTypes::CipherType cipherType) {
+#ifdef USE_ENCRYPTION
+    switch (cipherType) {
+        case PakTypes::CipherType::XCHACHA20_POLY1305:
+            return true;
+        case PakTypes::CipherType::AES256_GCM:
+            // libsodium only implements AES-256-GCM with AES-NI and CLMUL (or the ARM crypto extensions)
+            return sodium_init() >= 0 && crypto_aead_aes256gcm_is_available() != 0;
+        default:
+            return false;
+    }
+#else
+    return false;
+#endif
+}
+
+PakTypes::CipherType Cipher::Select(PakTypes::CipherType cipherType) {
+    return IsAvailable(cipherType) ? cipherType : PakTypes::CipherType::XCHACHA20_POLY1305;
+}
+
+size_t Cipher::GetNonceSize(PakTypes::CipherType cipherType) {
+    return cipherType == PakTypes::CipherType::AES256_GCM ? 12 : NonceSlotSize;
+}
+
+void Cipher::GetSegmentNonce(PakTypes::CipherType cipherType, const unsigned char *entryNonce, uint64_t segment,
+                             bool last, unsigned char *nonce) {
+    size_t nonceSize = GetNonceSize(cipherType);
+
+    std::memcpy(nonce, entryNonce, NonceSlotSize);
+    for (size_t i = 0; i < sizeof(segment); i++)
+        nonce[nonceSize - sizeof(segment) + i] ^= (segment >> (i * 8)) & 0xff;
+    if (last)
+        nonce[nonceSize - sizeof(segment) - 1] ^= 0x80;
+}
+
+void Cipher::Seal(PakTypes::CipherType cipherType, const unsigned char *key, const unsigned char *nonce,
+                  const unsigned char *message, size_t size, unsigned char *ciphertext, unsigned char *mac) {
+#ifdef USE_ENCRYPTION
+    int result = -1;
+    switch (cipherType) {
+        case PakTypes::CipherType::XCHACHA20_POLY1305:
+            result = crypto_secretbox_xchacha20poly1305_detached(ciphertext, mac, message, size, nonce, key);
+            break;
+        case PakTypes::CipherType::AES256_GCM:
+            if (!IsAvailable(cipherType))
+                throw std::runtime_error("AES-256-GCM is not supported on this machine");
+            result = crypto_aead_aes256gcm_encrypt_detached(ciphertext, mac, nullptr, message, size, nullptr, 0,
+                                                            nullptr, nonce, key);
+            break;
+        default:
+            throw std::runtime_error("Unknown cipher type");
+    }
+
+    if (result != 0)
+        throw std::runtime_error("Encryption failed");
+#else
+    throw std::runtime_error("Encryption is not supported");
+#endif
+}
+
+bool Cipher::Open(PakTypes::CipherType cipherType, const unsigned char *key, const unsigned char *nonce,
+                  const unsigned char *ciphertext, size_t size, const unsigned char *mac, unsigned char *message) {
+#ifdef USE_ENCRYPTION
+    switch (cipherType) {
+        case PakTypes::CipherType::XCHACHA20_POLY1305:
+            return crypto_secretbox_xchacha20poly1305_open_detached(message, ciphertext, mac, size, nonce, key) == 0;
+        case PakTypes::CipherType::AES256_GCM:
+            if (!IsAvailable(cipherType))
+                throw std::runtime_error("AES-256-GCM is not supported on this machine");
+            return crypto_aead_aes256gcm_decrypt_detached(message, nullptr, ciphertext, size, mac, nullptr, 0, nonce,
+                                                          key) == 0;
+        default:
+            throw std::runtime_error("Unknown cipher type");
+    }
+#else
+    throw std::runtime_error("Encryption is not supported");
+#endif
+}
+
+const char *Cipher::CipherTypeToString(PakTypes::CipherType type) {
+    switch (type) {
+        case PakTypes::CipherType::XCHACHA20_POLY1305:
+            return "XChaCha20-Poly1305";
+        case PakTypes::CipherType::AES256_GCM:
+            return "AES-256-GCM";
+        default:
+            return "Unknown";
+    }
+}
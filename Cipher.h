@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "PakTypes.h"
+
+// Authenticated encryption for pak entries. Every cipher takes a 32 byte key and produces a 16 byte MAC. Entries
+// reserve an XChaCha20 sized nonce slot, of which AES-256-GCM uses the first 12 bytes.
+class Cipher {
+public:
+    static constexpr size_t NonceSlotSize = 24;
+    static constexpr size_t MacSize = 16;
+
+    static bool IsAvailable(PakTypes::CipherType cipherType);
+
+    // Returns cipherType when this machine supports it and XChaCha20-Poly1305 otherwise
+    static PakTypes::CipherType Select(PakTypes::CipherType cipherType);
+
+    static size_t GetNonceSize(PakTypes::CipherType cipherType);
+
+    // Mixes the segment index into the tail of the cipher's nonce and flags the last segment, so segments can't be
+    // reordered or truncated
+    static void GetSegmentNonce(PakTypes::CipherType cipherType, const unsigned char *entryNonce, uint64_t segment,
+                                bool last, unsigned char *nonce);
+
+    // message and ciphertext may be the same buffer
+    static void Seal(PakTypes::CipherType cipherType, const unsigned char *key, const unsigned char *nonce,
+                     const unsigned char *message, size_t size, unsigned char *ciphertext, unsigned char *mac);
+
+    // Returns false if the MAC does not match. ciphertext and message may be the same buffer.
+    static bool Open(PakTypes::CipherType cipherType, const unsigned char *key, const unsigned char *nonce,
+                     const unsigned char *ciphertext, size_t size, const unsigned char *mac, unsigned char *message);
+
+    static const char *CipherTypeToString(PakTypes::CipherType type);
+};
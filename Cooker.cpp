@@ -0,0 +1,234 @@
+#include "Cooker.h"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+#include "Checksum.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "External/stb_image.h"
+
+Cooker::Cooker() {
+    RegisterTransform(PakTypes::CookType::IMAGE_RGBA, CookImage, 1);
+    RegisterTransform(PakTypes::CookType::JSON_MINIFY, MinifyJson, 1);
+    RegisterTransform(PakTypes::CookType::TEXT_NORMALIZE, NormalizeText, 1);
+}
+
+void Cooker::RegisterTransform(PakTypes::CookType id, Transform transform, uint32_t version) {
+    if (id == PakTypes::CookType::NONE || !transform)
+        throw std::runtime_error("Invalid cook transform");
+
+    transforms[id] = {std::move(transform), version};
+}
+
+void Cooker::AddRule(const std::string &extension, PakTypes::CookType cookType) {
+    if (cookType != PakTypes::CookType::NONE && !HasTransform(cookType))
+        throw std::runtime_error("No transform registered for cook type " + std::to_string(cookType));
+
+    rules[NormalizeExtension(extension)] = cookType;
+}
+
+void Cooker::AddDefaultRules(bool cookImages, bool minifyJson, bool normalizeText) {
+    if (cookImages) {
+        for (const char *extension: {".png", ".jpg", ".jpeg", ".tga", ".bmp", ".gif", ".psd", ".hdr", ".pic"})
+            AddRule(extension, PakTypes::CookType::IMAGE_RGBA);
+    }
+    if (minifyJson)
+        AddRule(".json", PakTypes::CookType::JSON_MINIFY);
+    if (normalizeText) {
+        for (const char *extension: {".txt", ".csv", ".xml", ".ini", ".cfg", ".lua", ".glsl", ".hlsl"})
+            AddRule(extension, PakTypes::CookType::TEXT_NORMALIZE);
+    }
+}
+
+PakTypes::CookType Cooker::GetCookType(const std::string &path) const {
+    auto rule = rules.find(NormalizeExtension(std::filesystem::path(path).extension().string()));
+    return rule != rules.end() ? rule->second : PakTypes::CookType::NONE;
+}
+
+std::vector<char> Cooker::Cook(PakTypes::CookType cookType, const std::vector<char> &data, const std::string &path) {
+    if (cookType == PakTypes::CookType::NONE)
+        return data;
+
+    auto transform = transforms.find(cookType);
+    if (transform == transforms.end())
+        throw std::runtime_error("Unknown cook type for file: " + path);
+
+    uint64_t key = PakTypes::HashBytes(std::string_view(data.data(), data.size()));
+    key = PakTypes::HashCombine(key, data.size());
+    key = PakTypes::HashCombine(key, cookType);
+    key = PakTypes::HashCombine(key, transform->second.version);
+    key = PakTypes::HashCombine(key, CookVersion);
+
+    CacheHeader cacheHeader;
+    std::filesystem::path cachePath;
+    if (!cacheDirectory.empty()) {
+        char name[17]{};
+        std::to_chars(name, name + 16, key, 16);
+        cachePath = std::filesystem::path(cacheDirectory) / (std::string(name) + ".cooked");
+
+        cacheHeader.CookType = cookType;
+        cacheHeader.TransformVersion = transform->second.version;
+        cacheHeader.SourceSize = data.size();
+        cacheHeader.SourceChecksum = Checksum::Crc32c(data.data(), data.size());
+
+        std::vector<char> cached;
+        if (ReadCache(cachePath, cacheHeader, cached))
+            return cached;
+    }
+
+    std::vector<char> cooked;
+    try {
+        cooked = transform->second.cook(data);
+    } catch (const std::exception &e) {
+        throw std::runtime_error(std::string(e.what()) + ": " + path);
+    }
+
+    if (!cachePath.empty())
+        WriteCache(cachePath, cacheHeader, cooked);
+
+    return cooked;
+}
+
+bool Cooker::ReadCache(const std::filesystem::path &cachePath, const CacheHeader &expected, std::vector<char> &cooked) {
+    std::ifstream input(cachePath, std::ios::binary);
+    CacheHeader header;
+    if (!input || !input.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+
+    // The file name is only a 64-bit hash, so the source is checked again before the entry is trusted
+    if (std::memcmp(header.ID, expected.ID, sizeof(header.ID)) != 0 || header.CookType != expected.CookType ||
+        header.TransformVersion != expected.TransformVersion || header.SourceSize != expected.SourceSize ||
+        header.SourceChecksum != expected.SourceChecksum)
+        return false;
+
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(cachePath, error);
+    if (error || fileSize != sizeof(header) + header.CookedSize)
+        return false;
+
+    cooked.resize(header.CookedSize);
+    if (!input.read(cooked.data(), static_cast<std::streamsize>(cooked.size())))
+        return false;
+
+    return Checksum::Crc32c(cooked.data(), cooked.size()) == header.CookedChecksum;
+}
+
+void Cooker::WriteCache(const std::filesystem::path &cachePath, CacheHeader header, const std::vector<char> &cooked) {
+    header.CookedSize = cooked.size();
+    header.CookedChecksum = Checksum::Crc32c(cooked.data(), cooked.size());
+
+    // Packers running side by side can share a cache directory, so every write gets its own temp file
+    static const uint64_t processId = std::random_device()();
+    static std::atomic<uint64_t> writeCount{0};
+    std::filesystem::path tempPath = cachePath;
+    tempPath += "." + std::to_string(processId) + "-" +
+                std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "-" +
+                std::to_string(writeCount.fetch_add(1)) + ".tmp";
+
+    std::error_code error;
+    std::filesystem::create_directories(cachePath.parent_path(), error);
+
+    std::ofstream output(tempPath, std::ios::binary);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(cooked.data(), static_cast<std::streamsize>(cooked.size()));
+    output.close();
+
+    if (output)
+        std::filesystem::rename(tempPath, cachePath, error);
+    if (!output || error)
+        std::filesystem::remove(tempPath, error);
+}
+
+const char *Cooker::CookTypeToString(PakTypes::CookType type) {
+    switch (type) {
+        case PakTypes::CookType::NONE:
+            return "None";
+        case PakTypes::CookType::IMAGE_RGBA:
+            return "Image RGBA";
+        case PakTypes::CookType::JSON_MINIFY:
+            return "Minified JSON";
+        case PakTypes::CookType::TEXT_NORMALIZE:
+            return "Normalized Text";
+        default:
+            return type >= PakTypes::CookType::CUSTOM ? "Custom" : "Unknown";
+    }
+}
+
+std::vector<char> Cooker::CookImage(const std::vector<char> &data) {
+    int width, height, channels;
+    stbi_uc *pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(data.data()), static_cast<int>(data.size()),
+                                            &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == nullptr)
+        throw std::runtime_error(std::string("Failed to decode image (") + stbi_failure_reason() + ")");
+
+    PakTypes::CookedImageHeader header{};
+    header.Width = static_cast<uint32_t>(width);
+    header.Height = static_cast<uint32_t>(height);
+
+    size_t pixelSize = static_cast<size_t>(width) * height * header.Channels;
+    std::vector<char> cooked(sizeof(header) + pixelSize);
+    std::memcpy(cooked.data(), &header, sizeof(header));
+    std::memcpy(cooked.data() + sizeof(header), pixels, pixelSize);
+    stbi_image_free(pixels);
+
+    return cooked;
+}
+
+std::vector<char> Cooker::MinifyJson(const std::vector<char> &data) {
+    std::vector<char> minified;
+    minified.reserve(data.size());
+
+    bool inString = false;
+    bool escaped = false;
+
+    for (char c: data) {
+        if (inString) {
+            minified.push_back(c);
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == '"')
+                inString = false;
+        } else if (c == '"') {
+            inString = true;
+            minified.push_back(c);
+        } else if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            minified.push_back(c);
+        }
+    }
+
+    return minified;
+}
+
+std::vector<char> Cooker::NormalizeText(const std::vector<char> &data) {
+    std::vector<char> normalized;
+    normalized.reserve(data.size());
+
+    size_t start = data.size() >= 3 && std::memcmp(data.data(), "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+
+    for (size_t i = start; i < data.size(); i++) {
+        if (data[i] != '\r') {
+            normalized.push_back(data[i]);
+        } else if (i + 1 >= data.size() || data[i + 1] != '\n') {
+            normalized.push_back('\n');
+        }
+    }
+
+    return normalized;
+}
+
+std::string Cooker::NormalizeExtension(const std::string &extension) {
+    std::string normalized = !extension.empty() && extension[0] != '.' ? "." + extension : extension;
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return normalized;
+}
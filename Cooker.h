@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include "PakTypes.h"
+
+class Cooker {
+public:
+    using Transform = std::function<std::vector<char>(const std::vector<char> &)>;
+
+    // Registers IMAGE_RGBA, JSON_MINIFY and TEXT_NORMALIZE
+    Cooker();
+
+    // Replaces any transform already registered under id. Bump version whenever the output of the transform changes,
+    // so cached results from the previous version are not reused.
+    void RegisterTransform(PakTypes::CookType id, Transform transform, uint32_t version);
+
+    [[nodiscard]] bool HasTransform(PakTypes::CookType id) const { return transforms.count(id) != 0; }
+
+    // Throws if no transform is registered under cookType
+    void AddRule(const std::string &extension, PakTypes::CookType cookType);
+
+    void ClearRules() { rules.clear(); }
+
+    // Decodes common image formats to RGBA, minifies JSON and normalizes text files by extension
+    void AddDefaultRules(bool cookImages, bool minifyJson, bool normalizeText);
+
+    [[nodiscard]] PakTypes::CookType GetCookType(const std::string &path) const;
+
+    // Returns the transformed data. When a cache directory is set, results are reused by input hash across runs.
+    std::vector<char> Cook(PakTypes::CookType cookType, const std::vector<char> &data, const std::string &path);
+
+    static const char *CookTypeToString(PakTypes::CookType type);
+
+    // Lowercases the extension and adds the leading dot, so ".PNG", "png" and ".png" match the same rules
+    static std::string NormalizeExtension(const std::string &extension);
+
+    [[nodiscard]] std::string getCacheDirectory() const { return cacheDirectory; }
+
+    void setCacheDirectory(const std::string &directory) { cacheDirectory = directory; }
+
+private:
+    static constexpr uint64_t CookVersion = 3;
+
+    struct RegisteredTransform {
+        Transform cook;
+        uint32_t version = 0;
+    };
+
+    // Written ahead of the cooked bytes in each cache file. A hit needs the source and cooked data to match it.
+    struct CacheHeader {
+        char ID[4] = {'C', 'O', 'O', 'K'};
+        uint32_t CookType = 0;
+        uint32_t TransformVersion = 0;
+        uint64_t SourceSize = 0;
+        uint64_t CookedSize = 0;
+        uint32_t SourceChecksum = 0;
+        uint32_t CookedChecksum = 0;
+    };
+
+    std::unordered_map<uint32_t, RegisteredTransform> transforms;
+    std::unordered_map<std::string, PakTypes::CookType> rules;
+    std::string cacheDirectory;
+
+    static std::vector<char> CookImage(const std::vector<char> &data);
+
+    static std::vector<char> MinifyJson(const std::vector<char> &data);
+
+    static std::vector<char> NormalizeText(const std::vector<char> &data);
+
+    static bool ReadCache(const std::filesystem::path &cachePath, const CacheHeader &expected,
+                          std::vector<char> &cooked);
+
+    static void WriteCache(const std::filesystem::path &cachePath, CacheHeader header, const std::vector<char> &cooked);
+};
@@ -0,0 +1,78 @@
+#include "EntryCache.h"
+
+EntryCache::Buffer EntryCache::Find(size_t entryIndex) {
+    std::lock_guard lock(mutex);
+
+    auto it = lookup.find(entryIndex);
+    if (it == lookup.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+
+    items.splice(items.begin(), items, it->second);
+    stats.hits++;
+
+    return it->second->buffer;
+}
+
+void EntryCache::Insert(size_t entryIndex, const Buffer &buffer) {
+    if (!buffer)
+        return;
+
+    std::lock_guard lock(mutex);
+
+    if (buffer->size() > budget)
+        return;
+
+    auto it = lookup.find(entryIndex);
+    if (it != lookup.end()) {
+        stats.residentBytes -= it->second->buffer->size();
+        it->second->buffer = buffer;
+        items.splice(items.begin(), items, it->second);
+    } else {
+        items.push_front({entryIndex, buffer});
+        lookup[entryIndex] = items.begin();
+    }
+
+    stats.residentBytes += buffer->size();
+    EvictToBudget();
+}
+
+void EntryCache::Clear() {
+    std::lock_guard lock(mutex);
+
+    items.clear();
+    lookup.clear();
+    stats.residentBytes = 0;
+}
+
+EntryCache::Stats EntryCache::GetStats() const {
+    std::lock_guard lock(mutex);
+
+    Stats result = stats;
+    result.residentEntries = items.size();
+
+    return result;
+}
+
+size_t EntryCache::getBudget() const {
+    std::lock_guard lock(mutex);
+    return budget;
+}
+
+void EntryCache::setBudget(size_t budgetBytes) {
+    std::lock_guard lock(mutex);
+
+    budget = budgetBytes;
+    EvictToBudget();
+}
+
+void EntryCache::EvictToBudget() {
+    while (stats.residentBytes > budget && !items.empty()) {
+        const Item &item = items.back();
+        stats.residentBytes -= item.buffer->size();
+        stats.evictions++;
+        lookup.erase(item.entryIndex);
+        items.pop_back();
+    }
+}
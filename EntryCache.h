@@ -0,0 +1,54 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+class EntryCache {
+public:
+    using Buffer = std::shared_ptr<const std::vector<char>>;
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t residentBytes = 0;
+        size_t residentEntries = 0;
+
+        [[nodiscard]] double HitRate() const {
+            size_t lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+        }
+    };
+
+    explicit EntryCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+    Buffer Find(size_t entryIndex);
+
+    void Insert(size_t entryIndex, const Buffer &buffer);
+
+    void Clear();
+
+    [[nodiscard]] Stats GetStats() const;
+
+    [[nodiscard]] size_t getBudget() const;
+
+    void setBudget(size_t budgetBytes);
+
+private:
+    struct Item {
+        size_t entryIndex;
+        Buffer buffer;
+    };
+
+    void EvictToBudget();
+
+    size_t budget;
+    Stats stats;
+
+    std::list<Item> items;
+    std::unordered_map<size_t, std::list<Item>::iterator> lookup;
+    mutable std::mutex mutex;
+};
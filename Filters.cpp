@@ -0,0 +1,307 @@
+#include "Filters.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FILTERS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    template<size_t Size>
+    using Element = std::conditional_t<Size == 1, uint8_t, std::conditional_t<Size == 2, uint16_t,
+            std::conditional_t<Size == 4, uint32_t, uint64_t>>>;
+
+    template<typename T>
+    T Load(const char *data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    void Store(char *data, T value) {
+        std::memcpy(data, &value, sizeof(T));
+    }
+
+#ifdef FILTERS_SSE2
+    template<typename T, bool Xor>
+    __m128i Combine(__m128i a, __m128i b) {
+        if constexpr (Xor)
+            return _mm_xor_si128(a, b);
+        else if constexpr (sizeof(T) == 1)
+            return _mm_add_epi8(a, b);
+        else if constexpr (sizeof(T) == 2)
+            return _mm_add_epi16(a, b);
+        else if constexpr (sizeof(T) == 4)
+            return _mm_add_epi32(a, b);
+        else
+            return _mm_add_epi64(a, b);
+    }
+
+    template<typename T>
+    __m128i Broadcast(T value) {
+        if constexpr (sizeof(T) == 1)
+            return _mm_set1_epi8(static_cast<char>(value));
+        else if constexpr (sizeof(T) == 2)
+            return _mm_set1_epi16(static_cast<short>(value));
+        else if constexpr (sizeof(T) == 4)
+            return _mm_set1_epi32(static_cast<int>(value));
+        else
+            return _mm_set1_epi64x(static_cast<long long>(value));
+    }
+
+    // Moves the even 16-bit words into the low half and the odd words into the high half
+    __m128i SplitWords(__m128i value) {
+        value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 1, 2, 0));
+        value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(3, 1, 2, 0));
+        return _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+
+    size_t ShuffleSse2(size_t elementSize, const char *source, char *destination, size_t count) {
+        const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+        size_t i = 0;
+
+        if (elementSize == 2) {
+            for (; i + 16 <= count; i += 16) {
+                __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 2));
+                __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 2 + 16));
+
+                __m128i p0 = _mm_packus_epi16(_mm_and_si128(v0, lowBytes), _mm_and_si128(v1, lowBytes));
+                __m128i p1 = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), p0);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + count + i), p1);
+            }
+        } else if (elementSize == 4) {
+            for (; i + 16 <= count; i += 16) {
+                __m128i e0 = SplitWords(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4)));
+                __m128i e1 = SplitWords(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4 + 16)));
+                __m128i e2 = SplitWords(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4 + 32)));
+                __m128i e3 = SplitWords(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4 + 48)));
+
+                __m128i low0 = _mm_unpacklo_epi64(e0, e1);
+                __m128i high0 = _mm_unpackhi_epi64(e0, e1);
+                __m128i low1 = _mm_unpacklo_epi64(e2, e3);
+                __m128i high1 = _mm_unpackhi_epi64(e2, e3);
+
+                __m128i p0 = _mm_packus_epi16(_mm_and_si128(low0, lowBytes), _mm_and_si128(low1, lowBytes));
+                __m128i p1 = _mm_packus_epi16(_mm_srli_epi16(low0, 8), _mm_srli_epi16(low1, 8));
+                __m128i p2 = _mm_packus_epi16(_mm_and_si128(high0, lowBytes), _mm_and_si128(high1, lowBytes));
+                __m128i p3 = _mm_packus_epi16(_mm_srli_epi16(high0, 8), _mm_srli_epi16(high1, 8));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), p0);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + count + i), p1);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + count * 2 + i), p2);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + count * 3 + i), p3);
+            }
+        }
+
+        return i;
+    }
+
+    size_t UnshuffleSse2(size_t elementSize, const char *source, char *destination, size_t count) {
+        size_t i = 0;
+
+        if (elementSize == 2) {
+            for (; i + 16 <= count; i += 16) {
+                __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+                __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + count + i));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 2), _mm_unpacklo_epi8(p0, p1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 2 + 16), _mm_unpackhi_epi8(p0, p1));
+            }
+        } else if (elementSize == 4) {
+            for (; i + 16 <= count; i += 16) {
+                __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+                __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + count + i));
+                __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + count * 2 + i));
+                __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + count * 3 + i));
+
+                __m128i low0 = _mm_unpacklo_epi8(p0, p1);
+                __m128i low1 = _mm_unpackhi_epi8(p0, p1);
+                __m128i high0 = _mm_unpacklo_epi8(p2, p3);
+                __m128i high1 = _mm_unpackhi_epi8(p2, p3);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 4), _mm_unpacklo_epi16(low0, high0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 4 + 16), _mm_unpackhi_epi16(low0, high0));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 4 + 32), _mm_unpacklo_epi16(low1, high1));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 4 + 48), _mm_unpackhi_epi16(low1, high1));
+            }
+        }
+
+        return i;
+    }
+#endif
+}
+
+std::vector<char> Filters::Apply(PakTypes::FilterType filterType, size_t elementSize, const std::vector<char> &data) {
+    if (!IsValidElementSize(elementSize))
+        throw std::runtime_error("Invalid filter element size: " + std::to_string(elementSize));
+
+    std::vector<char> filtered(data.size());
+    if (filterType == PakTypes::FilterType::UNFILTERED) {
+        std::memcpy(filtered.data(), data.data(), data.size());
+        return filtered;
+    }
+
+    if (filterType == PakTypes::FilterType::SHUFFLE) {
+        Shuffle(elementSize, data.data(), filtered.data(), data.size());
+        return filtered;
+    }
+
+    bool xorDelta = filterType == PakTypes::FilterType::XOR_DELTA;
+    size_t count = data.size() / elementSize;
+
+    std::vector<char> difference(data);
+    switch (elementSize) {
+        case 1:
+            xorDelta ? Difference<uint8_t, true>(data.data(), difference.data(), count)
+                     : Difference<uint8_t, false>(data.data(), difference.data(), count);
+            break;
+        case 2:
+            xorDelta ? Difference<uint16_t, true>(data.data(), difference.data(), count)
+                     : Difference<uint16_t, false>(data.data(), difference.data(), count);
+            break;
+        case 4:
+            xorDelta ? Difference<uint32_t, true>(data.data(), difference.data(), count)
+                     : Difference<uint32_t, false>(data.data(), difference.data(), count);
+            break;
+        default:
+            xorDelta ? Difference<uint64_t, true>(data.data(), difference.data(), count)
+                     : Difference<uint64_t, false>(data.data(), difference.data(), count);
+            break;
+    }
+
+    Shuffle(elementSize, difference.data(), filtered.data(), difference.size());
+    return filtered;
+}
+
+void Filters::Undo(PakTypes::FilterType filterType, size_t elementSize, const char *source, char *destination,
+                   size_t size) {
+    if (!IsValidElementSize(elementSize))
+        throw std::runtime_error("Invalid filter element size: " + std::to_string(elementSize));
+
+    if (filterType == PakTypes::FilterType::UNFILTERED) {
+        std::memcpy(destination, source, size);
+        return;
+    }
+
+    Unshuffle(elementSize, source, destination, size);
+
+    if (filterType == PakTypes::FilterType::DELTA || filterType == PakTypes::FilterType::XOR_DELTA)
+        PrefixSum(elementSize, filterType == PakTypes::FilterType::XOR_DELTA, destination, size / elementSize);
+}
+
+const char *Filters::FilterTypeToString(PakTypes::FilterType type) {
+    switch (type) {
+        case PakTypes::FilterType::UNFILTERED:
+            return "None";
+        case PakTypes::FilterType::SHUFFLE:
+            return "Shuffle";
+        case PakTypes::FilterType::DELTA:
+            return "Delta";
+        case PakTypes::FilterType::XOR_DELTA:
+            return "XOR Delta";
+        default:
+            return "Unknown";
+    }
+}
+
+void Filters::Shuffle(size_t elementSize, const char *source, char *destination, size_t size) {
+    size_t count = size / elementSize;
+    size_t i = 0;
+
+#ifdef FILTERS_SSE2
+    i = ShuffleSse2(elementSize, source, destination, count);
+#endif
+
+    for (; i < count; i++) {
+        for (size_t byte = 0; byte < elementSize; byte++)
+            destination[byte * count + i] = source[i * elementSize + byte];
+    }
+
+    std::memcpy(destination + count * elementSize, source + count * elementSize, size - count * elementSize);
+}
+
+void Filters::Unshuffle(size_t elementSize, const char *source, char *destination, size_t size) {
+    size_t count = size / elementSize;
+    size_t i = 0;
+
+#ifdef FILTERS_SSE2
+    i = UnshuffleSse2(elementSize, source, destination, count);
+#endif
+
+    for (; i < count; i++) {
+        for (size_t byte = 0; byte < elementSize; byte++)
+            destination[i * elementSize + byte] = source[byte * count + i];
+    }
+
+    std::memcpy(destination + count * elementSize, source + count * elementSize, size - count * elementSize);
+}
+
+template<typename T, bool Xor>
+void Filters::Difference(const char *source, char *destination, size_t count) {
+    T previous = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        T value = Load<T>(source + i * sizeof(T));
+        Store<T>(destination + i * sizeof(T), Xor ? static_cast<T>(value ^ previous) : static_cast<T>(value - previous));
+        previous = value;
+    }
+}
+
+template<typename T, bool Xor>
+void Filters::PrefixSum(char *data, size_t count) {
+    size_t i = 0;
+    T previous = 0;
+
+#ifdef FILTERS_SSE2
+    constexpr size_t lanes = 16 / sizeof(T);
+    __m128i carry = _mm_setzero_si128();
+
+    for (; i + lanes <= count; i += lanes) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * sizeof(T)));
+
+        value = Combine<T, Xor>(value, _mm_slli_si128(value, sizeof(T)));
+        if constexpr (sizeof(T) <= 4)
+            value = Combine<T, Xor>(value, _mm_slli_si128(value, sizeof(T) * 2));
+        if constexpr (sizeof(T) <= 2)
+            value = Combine<T, Xor>(value, _mm_slli_si128(value, sizeof(T) * 4));
+        if constexpr (sizeof(T) == 1)
+            value = Combine<T, Xor>(value, _mm_slli_si128(value, 8));
+        value = Combine<T, Xor>(value, carry);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i * sizeof(T)), value);
+
+        previous = Load<T>(data + (i + lanes - 1) * sizeof(T));
+        carry = Broadcast<T>(previous);
+    }
+#endif
+
+    for (; i < count; i++) {
+        T value = Load<T>(data + i * sizeof(T));
+        previous = Xor ? static_cast<T>(value ^ previous) : static_cast<T>(value + previous);
+        Store<T>(data + i * sizeof(T), previous);
+    }
+}
+
+void Filters::PrefixSum(size_t elementSize, bool xorDelta, char *data, size_t count) {
+    switch (elementSize) {
+        case 1:
+            xorDelta ? PrefixSum<uint8_t, true>(data, count) : PrefixSum<uint8_t, false>(data, count);
+            break;
+        case 2:
+            xorDelta ? PrefixSum<uint16_t, true>(data, count) : PrefixSum<uint16_t, false>(data, count);
+            break;
+        case 4:
+            xorDelta ? PrefixSum<uint32_t, true>(data, count) : PrefixSum<uint32_t, false>(data, count);
+            break;
+        default:
+            xorDelta ? PrefixSum<uint64_t, true>(data, count) : PrefixSum<uint64_t, false>(data, count);
+            break;
+    }
+}
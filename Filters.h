@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "PakTypes.h"
+
+class Filters {
+public:
+    static bool IsValidElementSize(size_t elementSize) {
+        return elementSize == 1 || elementSize == 2 || elementSize == 4 || elementSize == 8;
+    }
+
+    static std::vector<char> Apply(PakTypes::FilterType filterType, size_t elementSize, const std::vector<char> &data);
+
+    // Source and destination must not overlap
+    static void Undo(PakTypes::FilterType filterType, size_t elementSize, const char *source, char *destination,
+                     size_t size);
+
+    static const char *FilterTypeToString(PakTypes::FilterType type);
+
+    static void Shuffle(size_t elementSize, const char *source, char *destination, size_t size);
+
+    static void Unshuffle(size_t elementSize, const char *source, char *destination, size_t size);
+
+private:
+    template<typename T, bool Xor>
+    static void Difference(const char *source, char *destination, size_t count);
+
+    template<typename T, bool Xor>
+    static void PrefixSum(char *data, size_t count);
+
+    static void PrefixSum(size_t elementSize, bool xorDelta, char *data, size_t count);
+};
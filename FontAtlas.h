@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "imgui.h"
+#include "External/IconsFontAwesome6.h"
+
+class FontAtlas {
+public:
+    static constexpr float BaseFontSize = 16.0f;
+    static constexpr float LargeFontSize = 28.0f;
+    static constexpr float BakedScales[] = {1.0f, 1.25f, 1.5f, 1.75f, 2.0f};
+    static constexpr unsigned int BakedFontCount = 2;
+
+    static std::string GetEntryName(float scale) {
+        return "font_atlas_" + std::to_string(std::lround(scale * 100.0f));
+    }
+
+    // Fonts[0] is the main font with the icons merged in, Fonts[1] is the large font.
+    static void AddFonts(ImFontAtlas *atlas, std::vector<char> &mainFont, std::vector<char> &iconFont, float scale) {
+        ImFontConfig fontConfig;
+        fontConfig.FontDataOwnedByAtlas = false;
+        atlas->AddFontFromMemoryTTF(mainFont.data(), static_cast<int>(mainFont.size()), BaseFontSize * scale, &fontConfig);
+
+        float iconFontSize = BaseFontSize * 2.0f / 3.0f;
+        static const ImWchar icons_ranges[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
+        ImFontConfig icons_config;
+        icons_config.FontDataOwnedByAtlas = false;
+        icons_config.MergeMode = true;
+        icons_config.PixelSnapH = true;
+        icons_config.GlyphMinAdvanceX = iconFontSize;
+        atlas->AddFontFromMemoryTTF(iconFont.data(), static_cast<int>(iconFont.size()), BaseFontSize * scale, &icons_config, icons_ranges);
+
+        atlas->AddFontFromMemoryTTF(mainFont.data(), static_cast<int>(mainFont.size()), LargeFontSize * scale, &fontConfig);
+    }
+
+    static std::vector<char> Bake(std::vector<char> &mainFont, std::vector<char> &iconFont, float scale) {
+        ImFontAtlas atlas;
+        AddFonts(&atlas, mainFont, iconFont, scale);
+
+        unsigned char *pixels;
+        int width, height;
+        atlas.GetTexDataAsAlpha8(&pixels, &width, &height);
+
+        AtlasHeader header{};
+        header.Scale = scale;
+        header.TexWidth = width;
+        header.TexHeight = height;
+        header.FontCount = atlas.Fonts.Size;
+        header.CustomRectCount = atlas.CustomRects.Size;
+        header.TexUvWhitePixel = atlas.TexUvWhitePixel;
+        std::memcpy(header.TexUvLines, atlas.TexUvLines, sizeof(header.TexUvLines));
+        header.PackIdMouseCursors = atlas.PackIdMouseCursors;
+        header.PackIdLines = atlas.PackIdLines;
+
+        std::vector<char> output;
+        Append(output, &header, sizeof(header));
+        Append(output, pixels, static_cast<size_t>(width) * height);
+
+        for (ImFontAtlasCustomRect rect: atlas.CustomRects) {
+            rect.Font = nullptr;
+            Append(output, &rect, sizeof(rect));
+        }
+
+        for (const ImFont *font: atlas.Fonts) {
+            FontRecord record{};
+            record.FontSize = font->FontSize;
+            record.Ascent = font->Ascent;
+            record.Descent = font->Descent;
+            record.FallbackChar = font->FallbackChar;
+            record.EllipsisChar = font->EllipsisChar;
+            record.EllipsisCharCount = font->EllipsisCharCount;
+            record.EllipsisWidth = font->EllipsisWidth;
+            record.EllipsisCharStep = font->EllipsisCharStep;
+            record.GlyphCount = font->Glyphs.Size;
+
+            Append(output, &record, sizeof(record));
+            Append(output, font->Glyphs.Data, sizeof(ImFontGlyph) * font->Glyphs.Size);
+        }
+
+        return output;
+    }
+
+    // Replaces the atlas contents with a baked atlas. Returns false if the data is not a usable bake for this scale.
+    static bool Load(ImFontAtlas *atlas, const std::vector<char> &data, float scale) {
+        AtlasHeader header;
+        if (data.size() < sizeof(header))
+            return false;
+
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::memcmp(header.ID, "FNT", 4) != 0 || header.Version != ATLAS_VERSION ||
+            header.GlyphSize != sizeof(ImFontGlyph) || std::lround(header.Scale * 100.0f) != std::lround(scale * 100.0f) ||
+            header.TexWidth <= 0 || header.TexHeight <= 0 || header.FontCount < BakedFontCount)
+            return false;
+
+        size_t pixelSize = static_cast<size_t>(header.TexWidth) * header.TexHeight;
+        size_t offset = sizeof(header);
+        if (data.size() - offset < pixelSize + header.CustomRectCount * sizeof(ImFontAtlasCustomRect))
+            return false;
+
+        atlas->Clear();
+
+        atlas->TexPixelsAlpha8 = static_cast<unsigned char *>(IM_ALLOC(pixelSize));
+        std::memcpy(atlas->TexPixelsAlpha8, data.data() + offset, pixelSize);
+        offset += pixelSize;
+
+        atlas->CustomRects.resize(static_cast<int>(header.CustomRectCount));
+        std::memcpy(atlas->CustomRects.Data, data.data() + offset, header.CustomRectCount * sizeof(ImFontAtlasCustomRect));
+        offset += header.CustomRectCount * sizeof(ImFontAtlasCustomRect);
+
+        for (unsigned int i = 0; i < header.FontCount; i++) {
+            FontRecord record;
+            if (data.size() - offset < sizeof(record)) {
+                atlas->Clear();
+                return false;
+            }
+
+            std::memcpy(&record, data.data() + offset, sizeof(record));
+            offset += sizeof(record);
+
+            if (record.GlyphCount == 0 || (data.size() - offset) / sizeof(ImFontGlyph) < record.GlyphCount) {
+                atlas->Clear();
+                return false;
+            }
+
+            auto *font = IM_NEW(ImFont);
+            font->ContainerAtlas = atlas;
+            font->FontSize = record.FontSize;
+            font->Ascent = record.Ascent;
+            font->Descent = record.Descent;
+            font->FallbackChar = record.FallbackChar;
+            font->EllipsisChar = record.EllipsisChar;
+            font->Glyphs.resize(static_cast<int>(record.GlyphCount));
+            std::memcpy(font->Glyphs.Data, data.data() + offset, sizeof(ImFontGlyph) * record.GlyphCount);
+            font->BuildLookupTable();
+            font->EllipsisCharCount = record.EllipsisCharCount;
+            font->EllipsisWidth = record.EllipsisWidth;
+            font->EllipsisCharStep = record.EllipsisCharStep;
+            offset += sizeof(ImFontGlyph) * record.GlyphCount;
+
+            atlas->Fonts.push_back(font);
+        }
+
+        atlas->TexWidth = header.TexWidth;
+        atlas->TexHeight = header.TexHeight;
+        atlas->TexUvScale = ImVec2(1.0f / static_cast<float>(header.TexWidth), 1.0f / static_cast<float>(header.TexHeight));
+        atlas->TexUvWhitePixel = header.TexUvWhitePixel;
+        std::memcpy(atlas->TexUvLines, header.TexUvLines, sizeof(header.TexUvLines));
+        atlas->PackIdMouseCursors = header.PackIdMouseCursors;
+        atlas->PackIdLines = header.PackIdLines;
+        atlas->TexReady = true;
+
+        return true;
+    }
+
+private:
+    static constexpr unsigned int ATLAS_VERSION = 1;
+
+    struct AtlasHeader {
+        char ID[4] = {"FNT"};
+        unsigned int Version = ATLAS_VERSION;
+        unsigned int GlyphSize = sizeof(ImFontGlyph);
+        float Scale = 1.0f;
+        int TexWidth = 0;
+        int TexHeight = 0;
+        unsigned int FontCount = 0;
+        unsigned int CustomRectCount = 0;
+        ImVec2 TexUvWhitePixel;
+        ImVec4 TexUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+        int PackIdMouseCursors = -1;
+        int PackIdLines = -1;
+    };
+
+    struct FontRecord {
+        float FontSize = 0.0f;
+        float Ascent = 0.0f;
+        float Descent = 0.0f;
+        ImWchar FallbackChar = 0;
+        ImWchar EllipsisChar = 0;
+        short EllipsisCharCount = 0;
+        float EllipsisWidth = 0.0f;
+        float EllipsisCharStep = 0.0f;
+        unsigned int GlyphCount = 0;
+    };
+
+    static void Append(std::vector<char> &output, const void *data, size_t size) {
+        const char *bytes = static_cast<const char *>(data);
+        output.insert(output.end(), bytes, bytes + size);
+    }
+};
@@ -1,17 +1,5 @@
 #include "Gui.h"
 
-namespace cereal {
-    template<class Archive>
-    void serialize(Archive &archive, PakTypes::PakFileItem &item) {
-        archive(item.name, item.path, item.packedPath, item.size, item.compressed, item.encrypted);
-    }
-
-    template<class Archive>
-    void serialize(Archive &archive, ResPacker::Gui::ProjectFile &project) {
-        archive(project.version, project.compressionType, project.files);
-    }
-}
-
 namespace ResPacker {
     Gui::Gui() {
         LoadSettings();
@@ -83,6 +71,24 @@ namespace ResPacker {
 
             ImGui::Dummy(ImVec2(2.0f, 0.0f));
 
+            if (ImGui::BeginMenu("Tools")) {
+                if (ImGui::MenuItem(ICON_FA_FONT " Bake Font Atlas", nullptr, nullptr, !files.empty()))
+                    showFontAtlasWindow = true;
+                ImGui::Dummy(ImVec2(0.0f, 2.0f));
+                if (ImGui::MenuItem(ICON_FA_CODE_COMPARE " Create Patch Pak", nullptr, nullptr, !files.empty()))
+                    Gui::CreatePatch();
+                ImGui::Dummy(ImVec2(0.0f, 2.0f));
+                if (ImGui::MenuItem(ICON_FA_CODE_MERGE " Apply Patch Pak"))
+                    Gui::ApplyPatch();
+                ImGui::Dummy(ImVec2(0.0f, 2.0f));
+                if (ImGui::MenuItem(ICON_FA_SHIELD_HALVED " Verify Pak File", nullptr, nullptr, !verifyTask.valid()))
+                    Gui::VerifyPak();
+
+                ImGui::EndMenu();
+            }
+
+            ImGui::Dummy(ImVec2(2.0f, 0.0f));
+
             if (ImGui::BeginMenu("Help")) {
                 if (ImGui::MenuItem(ICON_FA_CIRCLE_INFO " About")) {
                     showAboutWindow = true;
@@ -126,7 +132,7 @@ namespace ResPacker {
                 if (!SaveFileName.empty()) {
                     packing_files = true;
                     ImGui::OpenPopup("Packing Progress");
-                    std::thread(&Gui::CreatePakFile, this, SaveFileName).detach();
+                    std::thread(&Gui::CreatePakFile, this, SaveFileName, std::string()).detach();
                 }
             }
         }
@@ -251,6 +257,8 @@ namespace ResPacker {
     }
 
     void Gui::RenderSettingsWindow() {
+        CollectEncryptionTuning();
+
         if (!showSettingsWindow) {
             return;
         }
@@ -284,6 +292,35 @@ namespace ResPacker {
                         "Lower values mean faster compression, higher values mean better compression, default is 8");
             ImGui::Dummy(ImVec2(0.0f, 2.0f));
 
+            ImGui::SeparatorText("Cooking Settings");
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+            ImGui::Checkbox("Decode images to raw RGBA", &settings.cookImages);
+            ImGui::SameLine();
+            ImGui::Text(ICON_FA_CIRCLE_QUESTION);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Images are decoded at pack time so they can be uploaded without decoding at runtime");
+            ImGui::Checkbox("Minify JSON", &settings.minifyJson);
+            ImGui::Checkbox("Normalize text line endings", &settings.normalizeText);
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            ImGui::SeparatorText("Deduplication Settings");
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+            ImGui::Checkbox("Content-defined chunking", &settings.chunking);
+            ImGui::SameLine();
+            ImGui::Text(ICON_FA_CIRCLE_QUESTION);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Unencrypted, unfiltered files are split into chunks and identical chunks are stored once");
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            ImGui::SeparatorText("Integrity Settings");
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+            ImGui::Checkbox("Verify checksums when unpacking", &settings.verifyChecksums);
+            ImGui::Checkbox("Store a Merkle tree in packed files", &settings.merkleTree);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Lets the unpacker verify only the blocks it reads instead of the whole pak");
+            ImGui::Checkbox("Verify the Merkle tree when unpacking", &settings.verifyMerkleTree);
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
             ImGui::SeparatorText("Encryption Settings");
             ImGui::PushStyleColor(ImGuiCol_Text, Theme::error_colour);
             ImGui::Text(ICON_FA_CIRCLE_EXCLAMATION);
@@ -317,6 +354,42 @@ namespace ResPacker {
             if (ImGui::RadioButton("Max", settings.encryptionMemLimit == crypto_pwhash_MEMLIMIT_MAX)) {
                 settings.encryptionMemLimit = crypto_pwhash_MEMLIMIT_MAX;
             }
+            ImGui::SameLine();
+            ImGui::Text("(%s)", Utils::FormatBytes(settings.encryptionMemLimit).c_str());
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            ImGui::BeginDisabled(encryptionTuning.valid());
+            if (ImGui::Button(ICON_FA_GAUGE " Autotune"))
+                encryptionTuning = std::async(std::launch::async, &Gui::TuneEncryptionLimits, false);
+            ImGui::SameLine();
+            ImGui::Text(ICON_FA_CIRCLE_QUESTION);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Picks the limits for a key derivation of about %.0f ms on this machine",
+                                  Kdf::DefaultTargetSeconds * 1000.0);
+            ImGui::SameLine();
+            if (ImGui::Button(ICON_FA_STOPWATCH " Benchmark"))
+                encryptionTuning = std::async(std::launch::async, &Gui::TuneEncryptionLimits, true);
+            ImGui::EndDisabled();
+            if (encryptionTuning.valid())
+                ImGui::Text("Measuring key derivation...");
+            else if (!encryptionReport.empty())
+                ImGui::TextUnformatted(encryptionReport.c_str());
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            ImGui::Text("Cipher");
+            ImGui::SameLine();
+            ImGui::Text(ICON_FA_CIRCLE_QUESTION);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("AES-256-GCM is faster on CPUs with AES instructions and falls back to XChaCha20-Poly1305 "
+                                  "where they are missing, default is XChaCha20-Poly1305");
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+            if (ImGui::RadioButton("XChaCha20-Poly1305", settings.cipher == PakTypes::CipherType::XCHACHA20_POLY1305)) {
+                settings.cipher = PakTypes::CipherType::XCHACHA20_POLY1305;
+            }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("AES-256-GCM", settings.cipher == PakTypes::CipherType::AES256_GCM)) {
+                settings.cipher = PakTypes::CipherType::AES256_GCM;
+            }
             ImGui::Dummy(ImVec2(0.0f, 2.0f));
 
             float button_width = ImGui::CalcTextSize(ICON_FA_WRENCH " Reset Defaults").x + ImGui::GetStyle().ItemSpacing.x * 4.5f;
@@ -399,7 +472,7 @@ namespace ResPacker {
 
         ImGui::Dummy(ImVec2(0.0f, 2.0f));
 
-        ImGui::BeginTable("my_table", 8, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_NoSavedSettings);
+        ImGui::BeginTable("my_table", 9, ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_NoSavedSettings);
 
         ImGui::TableSetupColumn("#");
         ImGui::TableSetupColumn("Filename");
@@ -408,6 +481,7 @@ namespace ResPacker {
         ImGui::TableSetupColumn("Size");
         ImGui::TableSetupColumn("Compressed");
         ImGui::TableSetupColumn("Encrypted");
+        ImGui::TableSetupColumn("Filter");
         ImGui::TableSetupColumn("");
 
         ImGui::TableHeadersRow();
@@ -438,6 +512,32 @@ namespace ResPacker {
             ImGui::TableNextColumn();
             ImGui::Checkbox("##encrypted", &files[i].encrypted);
 
+            ImGui::TableNextColumn();
+            ImGui::BeginDisabled(!files[i].compressed);
+            ImGui::SetNextItemWidth(100.0f);
+            if (ImGui::BeginCombo("##filter", Filters::FilterTypeToString(files[i].filter))) {
+                for (int filter = 0; filter < PakTypes::FilterCount; filter++) {
+                    auto filterType = static_cast<PakTypes::FilterType>(filter);
+                    if (ImGui::Selectable(Filters::FilterTypeToString(filterType), files[i].filter == filterType))
+                        files[i].filter = filterType;
+                }
+                ImGui::EndCombo();
+            }
+            if (files[i].filter != PakTypes::FilterType::UNFILTERED) {
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(50.0f);
+                if (ImGui::BeginCombo("##element_size", std::to_string(files[i].elementSize).c_str())) {
+                    for (uint32_t elementSize: {1u, 2u, 4u, 8u}) {
+                        if (ImGui::Selectable(std::to_string(elementSize).c_str(), files[i].elementSize == elementSize))
+                            files[i].elementSize = elementSize;
+                    }
+                    ImGui::EndCombo();
+                }
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("Element size in bytes");
+            }
+            ImGui::EndDisabled();
+
             ImGui::TableNextColumn();
             if (ImGui::Button(ICON_FA_PEN)) {
                 std::memcpy(editPackedPath, files[i].packedPath.c_str(), files[i].packedPath.size() + 1);
@@ -490,6 +590,115 @@ namespace ResPacker {
         }
     }
 
+    void Gui::RenderFontAtlasWindow() {
+        if (!showFontAtlasWindow) {
+            return;
+        }
+
+        ImGui::OpenPopup("Bake Font Atlas");
+
+        if (ImGui::BeginPopupModal("Bake Font Atlas", &showFontAtlasWindow, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings)) {
+            auto fontCombo = [this](const char *label, int &selected) {
+                if (selected >= static_cast<int>(files.size()))
+                    selected = -1;
+
+                if (ImGui::BeginCombo(label, selected >= 0 ? files[selected].packedPath.c_str() : "Select a font")) {
+                    for (int i = 0; i < files.size(); i++) {
+                        if (ImGui::Selectable(files[i].packedPath.c_str(), selected == i))
+                            selected = i;
+                    }
+                    ImGui::EndCombo();
+                }
+            };
+
+            fontCombo("Main Font", fontAtlasMainFont);
+            fontCombo("Icon Font", fontAtlasIconFont);
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            ImGui::SeparatorText("Scales");
+            for (int i = 0; i < std::size(FontAtlas::BakedScales); i++) {
+                if (i > 0)
+                    ImGui::SameLine();
+                string label = std::format("{}%", std::lround(FontAtlas::BakedScales[i] * 100.0f));
+                ImGui::Checkbox(label.c_str(), &fontAtlasScales[i]);
+            }
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            ImGui::BeginDisabled(fontAtlasMainFont < 0 || fontAtlasIconFont < 0);
+            if (ImGui::Button(ICON_FA_FONT " Bake")) {
+                string outputFolder = SelectFolder();
+                if (!outputFolder.empty()) {
+                    try {
+                        BakeFontAtlases(outputFolder);
+                        ImGui::CloseCurrentPopup();
+                        showFontAtlasWindow = false;
+                    } catch (const std::exception &e) {
+                        MessageBoxA(nullptr, e.what(), "Error", MB_ICONERROR | MB_OK);
+                    }
+                }
+            }
+            ImGui::EndDisabled();
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                ImGui::SetTooltip("Rasterizes the fonts for each scale and adds the atlases to the project");
+            ImGui::SameLine();
+            if (ImGui::Button(ICON_FA_XMARK " Close")) {
+                ImGui::CloseCurrentPopup();
+                showFontAtlasWindow = false;
+            }
+
+            ImGui::EndPopup();
+        }
+    }
+
+    void Gui::BakeFontAtlases(const std::string &outputFolder) {
+        auto readFont = [](const std::string &path) {
+            std::ifstream input(path, std::ios::binary);
+            if (!input)
+                throw std::runtime_error("Failed to open font file: " + path);
+
+            return vector<char>(std::istreambuf_iterator<char>(input), {});
+        };
+
+        vector<char> mainFont = readFont(files[fontAtlasMainFont].path);
+        vector<char> iconFont = readFont(files[fontAtlasIconFont].path);
+
+        for (int i = 0; i < std::size(FontAtlas::BakedScales); i++) {
+            if (!fontAtlasScales[i])
+                continue;
+
+            float atlasScale = FontAtlas::BakedScales[i];
+            string entryName = FontAtlas::GetEntryName(atlasScale);
+            string atlasPath = outputFolder + "/" + entryName + ".bin";
+
+            vector<char> atlas = FontAtlas::Bake(mainFont, iconFont, atlasScale);
+            {
+                std::ofstream out(atlasPath, std::ios::binary);
+                out.write(atlas.data(), static_cast<std::streamsize>(atlas.size()));
+                if (!out)
+                    throw std::runtime_error("Failed to write font atlas: " + atlasPath);
+            }
+
+            PakTypes::PakFileItem file = {
+                    .name = Paths::GetFileName(atlasPath),
+                    .path = atlasPath,
+                    .packedPath = entryName,
+                    .size = atlas.size(),
+                    .compressed = true
+            };
+
+            auto existing = std::find_if(files.begin(), files.end(), [&](const PakTypes::PakFileItem &item) {
+                return item.packedPath == entryName;
+            });
+
+            if (existing != files.end())
+                *existing = file;
+            else
+                files.emplace_back(file);
+        }
+
+        showFileWindow = true;
+    }
+
     void Gui::RenderExtractWindow() {
         if (!showExtractWindow) {
             return;
@@ -524,6 +733,7 @@ namespace ResPacker {
 
         ImGui::SameLine();
         if (ImGui::Button(ICON_FA_CODE " Generate Include File")) {
+            GenerateHeaderFile();
             showHeaderGenerationWindow = true;
         }
         if (ImGui::IsItemHovered())
@@ -620,18 +830,10 @@ namespace ResPacker {
             ImGui::Text("Header File");
             ImGui::Dummy(ImVec2(0.0f, 2.0f));
 
-            string headerFile = "#pragma once\n\nnamespace Resources {\n";
-
-            int i = 1;
-
-            for (auto &file: pakFile.FileEntries) {
-                string filePath = file.FilePath;
-                headerFile += std::format("    constexpr auto FILE_{} = \"{}\";\n", i, filePath);
-
-                i++;
-            }
-
-            headerFile += "}";
+            if (ImGui::Checkbox("Bake entry indices for this pak build", &bakeResourceIndices))
+                GenerateHeaderFile();
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Resource ids skip the lookup entirely when used with this exact pak file");
 
             ImGui::InputTextMultiline("##header", const_cast<char *>(headerFile.c_str()), headerFile.size(),
                                       ImVec2(450 * scale, ImGui::GetTextLineHeight() * 16), ImGuiInputTextFlags_ReadOnly);
@@ -672,6 +874,79 @@ namespace ResPacker {
         }
     }
 
+    void Gui::GenerateHeaderFile() {
+        headerFile = "#pragma once\n\n#include \"PakTypes.h\"\n\nnamespace Resources {\n";
+
+        if (bakeResourceIndices)
+            headerFile += std::format("    constexpr uint64_t PAK_BUILD_ID = {:#018x};\n\n", pakFile.Header.BuildId);
+
+        Unpacker::ForEachEntry(pakFile, [this](size_t i, const PakTypes::PakFileTableEntry &file) {
+            uint64_t pathHash = PakTypes::HashPath(file.FilePath);
+
+            headerFile += std::format("    constexpr auto FILE_{} = \"{}\";\n", i + 1, file.FilePath);
+
+            if (bakeResourceIndices) {
+                headerFile += std::format("    constexpr PakTypes::ResourceId FILE_{}_ID{{{:#018x}, PAK_BUILD_ID, {}, {}}};\n",
+                                          i + 1, pathHash, i, file.Offset);
+            } else {
+                headerFile += std::format("    constexpr PakTypes::ResourceId FILE_{}_ID{{{:#018x}}};\n", i + 1, pathHash);
+            }
+        });
+
+        headerFile += "}";
+    }
+
+    void Gui::RenderVerifyWindow() {
+        if (!showVerifyWindow) {
+            return;
+        }
+
+        ImGui::OpenPopup("Verify Pak File");
+
+        if (ImGui::BeginPopupModal("Verify Pak File", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings)) {
+            ImGui::Text("Pak file: %s", verifyPakPath.c_str());
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            if (verifyTask.valid()) {
+                if (verifyTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    ImGui::Text("Verifying entries...");
+                    ImGui::Dummy(ImVec2(0.0f, 5.0f));
+                    Widgets::IndeterminateProgressBar(ImVec2(300 * scale, 20 * scale));
+                    ImGui::EndPopup();
+                    return;
+                }
+
+                verifyResult = verifyTask.get();
+                verifyReport.clear();
+                for (const auto &error: verifyResult.Errors)
+                    verifyReport += error + "\n";
+            }
+
+            double throughput = verifyResult.Seconds > 0.0 ? verifyResult.OriginalBytes / verifyResult.Seconds / 1e9 : 0.0;
+            ImGui::Text("Entries checked: %zu", verifyResult.EntriesChecked);
+            if (verifyResult.EntriesSkipped > 0)
+                ImGui::Text("Patch entries skipped: %zu", verifyResult.EntriesSkipped);
+            ImGui::Text("Verified %s in %.2f seconds (%.2f GB/s)", Utils::FormatBytes(verifyResult.OriginalBytes).c_str(),
+                        verifyResult.Seconds, throughput);
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+
+            if (verifyResult.Errors.empty()) {
+                ImGui::Text(ICON_FA_CIRCLE_CHECK " No problems found");
+            } else {
+                ImGui::Text(ICON_FA_TRIANGLE_EXCLAMATION " %zu problems found", verifyResult.Errors.size());
+                ImGui::InputTextMultiline("##verify_errors", const_cast<char *>(verifyReport.c_str()), verifyReport.size(),
+                                          ImVec2(450 * scale, ImGui::GetTextLineHeight() * 10), ImGuiInputTextFlags_ReadOnly);
+            }
+
+            ImGui::Dummy(ImVec2(0.0f, 2.0f));
+            if (ImGui::Button(ICON_FA_XMARK " Close")) {
+                ImGui::CloseCurrentPopup();
+                showVerifyWindow = false;
+            }
+            ImGui::EndPopup();
+        }
+    }
+
     void Gui::RenderUnpackingCompleteWindow() {
         if (!showUnpackingCompleteWindow) {
             return;
@@ -693,28 +968,105 @@ namespace ResPacker {
         }
     }
 
-    void Gui::CreatePakFile(const std::string &targetPath) {
+    void Gui::CreatePakFile(const std::string &targetPath, const std::string &basePakPath) {
         packStart = std::chrono::high_resolution_clock::now();
         string pwd(password);
         packer.setPassword(pwd);
-        if (!packer.CreatePakFile(files, targetPath, compressionType)) {
-            MessageBoxA(nullptr, "Failed to create PAK file", "Error", MB_ICONERROR | MB_OK);
+        try {
+            bool created = basePakPath.empty() ? packer.CreatePakFile(files, targetPath, compressionType)
+                                               : packer.CreatePatchPakFile(files, basePakPath, targetPath, compressionType);
+            if (!created) {
+                MessageBoxA(nullptr, "Failed to create PAK file", "Error", MB_ICONERROR | MB_OK);
+            }
+        } catch (const std::exception &e) {
+            MessageBoxA(nullptr, e.what(), "Error", MB_ICONERROR | MB_OK);
         }
         packEnd = std::chrono::high_resolution_clock::now();
         packing_files = false;
         packing_complete = true;
     }
 
-    void Gui::OpenProjectFile(const std::string &filename) {
-        ProjectFile projectFile;
-        {
-            std::ifstream is(filename, std::ios::binary);
-            cereal::BinaryInputArchive archive(is);
-            archive(projectFile);
+    void Gui::MergePatchPakFile(const std::string &basePakPath, const std::string &patchPakPath,
+                                const std::string &targetPath) {
+        packStart = std::chrono::high_resolution_clock::now();
+        string pwd(password);
+        packer.setPassword(pwd);
+        try {
+            if (!packer.ApplyPatchPakFile(basePakPath, patchPakPath, targetPath)) {
+                MessageBoxA(nullptr, "Failed to apply patch", "Error", MB_ICONERROR | MB_OK);
+            }
+        } catch (const std::exception &e) {
+            MessageBoxA(nullptr, e.what(), "Error", MB_ICONERROR | MB_OK);
+        }
+        packEnd = std::chrono::high_resolution_clock::now();
+        packing_files = false;
+        packing_complete = true;
+    }
+
+    // Runs off the UI thread, so it only works on its arguments. RenderVerifyWindow collects the result.
+    PakTypes::PakVerifyResult Gui::VerifyPakFile(const std::string &pakPath, std::string pwd, size_t opsLimit,
+                                                 size_t memLimit) {
+        Unpacker verifier;
+        verifier.setPassword(pwd);
+        verifier.setEncryptionOpsLimit(opsLimit);
+        verifier.setEncryptionMemLimit(memLimit);
+        verifier.setVerifyMerkleTree(true);
+
+        PakTypes::PakVerifyResult result;
+        try {
+            PakTypes::PakFile pak = Unpacker::ParsePakFile(pakPath);
+            result = verifier.VerifyPakFile(pak);
+        } catch (const std::exception &e) {
+            result = {};
+            result.Errors.emplace_back(e.what());
+        }
+
+        return result;
+    }
+
+    // Runs off the UI thread. CollectEncryptionTuning applies the result.
+    Gui::EncryptionTuning Gui::TuneEncryptionLimits(bool benchmark) {
+        EncryptionTuning tuning;
+        std::string &report = tuning.report;
+
+        try {
+            if (benchmark) {
+                for (const auto &limits: Kdf::Benchmark({1, 2, 4}, {crypto_pwhash_MEMLIMIT_MIN,
+                                                                      crypto_pwhash_MEMLIMIT_INTERACTIVE,
+                                                                      crypto_pwhash_MEMLIMIT_MODERATE,
+                                                                      crypto_pwhash_MEMLIMIT_SENSITIVE})) {
+                    report += std::format("Ops {}, memory {}: {:.1f} ms\n", limits.OpsLimit,
+                                          Utils::FormatBytes(limits.MemLimit), limits.Seconds * 1000.0);
+                }
+            } else {
+                Kdf::Limits limits = Kdf::Autotune();
+                tuning.tuned = true;
+                tuning.opsLimit = limits.OpsLimit;
+                tuning.memLimit = limits.MemLimit;
+                report = std::format("Ops {}, memory {}: {:.1f} ms", limits.OpsLimit,
+                                     Utils::FormatBytes(limits.MemLimit), limits.Seconds * 1000.0);
+            }
+        } catch (const std::exception &e) {
+            report = e.what();
         }
 
-        if (projectFile.version != PROJECT_FILE_VERSION)
-            throw std::runtime_error("Invalid project file version");
+        return tuning;
+    }
+
+    void Gui::CollectEncryptionTuning() {
+        if (!encryptionTuning.valid() || encryptionTuning.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+
+        EncryptionTuning tuning = encryptionTuning.get();
+        if (tuning.tuned) {
+            settings.encryptionOpsLimit = tuning.opsLimit;
+            settings.encryptionMemLimit = tuning.memLimit;
+        }
+        encryptionReport = tuning.report;
+    }
+
+    void Gui::OpenProjectFile(const std::string &filename) {
+        ProjectFile projectFile = ProjectFile::Load(filename);
 
         compressionType = projectFile.compressionType;
         files = projectFile.files;
@@ -766,18 +1118,46 @@ namespace ResPacker {
         });
     }
 
+    void Gui::CreatePatch() {
+        Utils::OpenFile(L"Base Pak File (*.pak)\0*.pak\0", [this](const std::string &basePakPath) {
+            SaveFileName = Utils::SaveFile(L"Patch Pak File (*.pak)\0*.pak\0", SavePakFile);
+            if (!SaveFileName.empty()) {
+                packing_files = true;
+                std::thread(&Gui::CreatePakFile, this, SaveFileName, basePakPath).detach();
+            }
+        });
+    }
+
+    void Gui::ApplyPatch() {
+        Utils::OpenFile(L"Base Pak File (*.pak)\0*.pak\0", [this](const std::string &basePakPath) {
+            Utils::OpenFile(L"Patch Pak File (*.pak)\0*.pak\0", [this, &basePakPath](const std::string &patchPakPath) {
+                SaveFileName = Utils::SaveFile(L"Pak Files (*.pak)\0*.pak\0", SavePakFile);
+                if (!SaveFileName.empty()) {
+                    packing_files = true;
+                    std::thread(&Gui::MergePatchPakFile, this, basePakPath, patchPakPath, SaveFileName).detach();
+                }
+            });
+        });
+    }
+
+    void Gui::VerifyPak() {
+        Utils::OpenFile(L"Pak File (*.pak)\0*.pak\0", [this](const std::string &pakPath) {
+            verifyPakPath = pakPath;
+            showVerifyWindow = true;
+            verifyTask = std::async(std::launch::async, &Gui::VerifyPakFile, pakPath, std::string(password),
+                                    settings.encryptionOpsLimit, settings.encryptionMemLimit);
+        });
+    }
+
     void Gui::SaveProject() {
         std::string projectFileName = Utils::SaveFile(L"Pak Project (*.pakproj)\0*.pakproj\0", SaveProjectFile);
         if (!projectFileName.empty()) {
             ProjectFile projectFile {
-                .version = PROJECT_FILE_VERSION,
                 .compressionType = compressionType,
                 .files = files
             };
 
-            std::ofstream os(projectFileName, std::ios::binary);
-            cereal::BinaryOutputArchive archive(os);
-            archive(projectFile);
+            projectFile.Save(projectFileName);
         }
     }
 
@@ -787,6 +1167,14 @@ namespace ResPacker {
         settings.zstdCompressionLevel = 8;
         settings.encryptionOpsLimit = crypto_pwhash_OPSLIMIT_MIN;
         settings.encryptionMemLimit = crypto_pwhash_MEMLIMIT_MIN;
+        settings.cookImages = false;
+        settings.minifyJson = false;
+        settings.normalizeText = false;
+        settings.chunking = false;
+        settings.verifyChecksums = true;
+        settings.merkleTree = false;
+        settings.verifyMerkleTree = true;
+        settings.cipher = PakTypes::CipherType::XCHACHA20_POLY1305;
     }
 
     void Gui::SaveSettings() {
@@ -800,14 +1188,18 @@ namespace ResPacker {
     }
 
     void Gui::LoadSettings() {
-        if (std::ifstream is("settings", std::ios::binary); is.good()) {
-            cereal::BinaryInputArchive archive(is);
-            archive(settings);
+        Gui::defaultSettings();
 
-            Gui::ApplySettings();
-        } else {
-            Gui::defaultSettings();
+        if (std::ifstream is("settings", std::ios::binary); is.good()) {
+            // Settings saved by older versions stop early, the remaining fields keep their defaults
+            try {
+                cereal::BinaryInputArchive archive(is);
+                archive(settings);
+            } catch (const cereal::Exception &) {
+            }
         }
+
+        Gui::ApplySettings();
     }
 
     void Gui::ApplySettings() {
@@ -816,8 +1208,18 @@ namespace ResPacker {
         packer.setLz4CompressionLevel(settings.lz4CompressionLevel);
         packer.setEncryptionOpsLimit(settings.encryptionOpsLimit);
         packer.setEncryptionMemLimit(settings.encryptionMemLimit);
+        packer.setChunking(settings.chunking);
+        packer.setMerkleTree(settings.merkleTree);
+        packer.setCipher(settings.cipher);
 
         unpacker.setEncryptionOpsLimit(settings.encryptionOpsLimit);
         unpacker.setEncryptionMemLimit(settings.encryptionMemLimit);
+        unpacker.setVerifyChecksums(settings.verifyChecksums);
+        unpacker.setVerifyMerkleTree(settings.verifyMerkleTree);
+
+        Cooker &cooker = packer.getCooker();
+        cooker.ClearRules();
+        cooker.setCacheDirectory(Utils::GetExecutableDirectory() + "/cook_cache");
+        cooker.AddDefaultRules(settings.cookImages, settings.minifyJson, settings.normalizeText);
     }
 }
\ No newline at end of file
@@ -3,9 +3,7 @@
 #include <fstream>
 #include <string>
 #include <thread>
-#include <cereal/types/vector.hpp>
-#include <cereal/types/string.hpp>
-#include <cereal/archives/binary.hpp>
+#include <future>
 #include "imgui.h"
 #include "imgui_internal.h"
 #include <GLFW/glfw3.h>
@@ -16,8 +14,10 @@
 #include "PakTypes.h"
 #include "Packer.h"
 #include "Unpacker.h"
+#include "Project.h"
 #include "Theme.h"
 #include "Widgets.h"
+#include "FontAtlas.h"
 
 namespace ResPacker {
     class Gui {
@@ -35,6 +35,8 @@ namespace ResPacker {
         void RenderExtractWindow();
         void RenderHeaderGenerationWindow();
         void RenderUnpackingCompleteWindow();
+        void RenderFontAtlasWindow();
+        void RenderVerifyWindow();
 
         GLFWwindow* window = nullptr;
 
@@ -57,21 +59,33 @@ namespace ResPacker {
 
         Unpacker unpacker;
 
-        struct ProjectFile {
-            unsigned int version;
-            PakTypes::CompressionType compressionType;
-            vector<PakTypes::PakFileItem> files;
-        };
-
     private:
         void OpenProject();
         void SaveProject();
+        void CreatePatch();
+        void ApplyPatch();
+        void VerifyPak();
 
         void OpenProjectFile(const std::string &filename);
         static std::string SaveProjectFile(std::string filename);
         static std::string SavePakFile(std::string filename);
         static std::string SaveHeaderFile(string filename);
-        void CreatePakFile(const std::string &targetPath);
+        void CreatePakFile(const std::string &targetPath, const std::string &basePakPath);
+        void MergePatchPakFile(const std::string &basePakPath, const std::string &patchPakPath,
+                               const std::string &targetPath);
+        static PakTypes::PakVerifyResult VerifyPakFile(const std::string &pakPath, std::string pwd,
+                                                       size_t opsLimit, size_t memLimit);
+        struct EncryptionTuning {
+            std::string report;
+            bool tuned = false;
+            size_t opsLimit = 0;
+            size_t memLimit = 0;
+        };
+
+        static EncryptionTuning TuneEncryptionLimits(bool benchmark);
+        void CollectEncryptionTuning();
+        void GenerateHeaderFile();
+        void BakeFontAtlases(const std::string &outputFolder);
         static std::string SelectFolder();
 
         void defaultSettings();
@@ -79,16 +93,18 @@ namespace ResPacker {
         void LoadSettings();
         void ApplySettings();
 
-        static constexpr auto PROJECT_FILE_VERSION = 1;
-
         bool showSettingsWindow = false;
         bool showAboutWindow = false;
         bool showEditPackedPathWindow = false;
         bool showUnpackingCompleteWindow = false;
         bool showHeaderGenerationWindow = false;
+        bool showFontAtlasWindow = false;
+        bool showVerifyWindow = false;
 
         bool packing_files = false;
         bool packing_complete = false;
+        std::future<PakTypes::PakVerifyResult> verifyTask;
+        std::future<EncryptionTuning> encryptionTuning;
 
         Packer packer;
 
@@ -98,9 +114,18 @@ namespace ResPacker {
         std::chrono::high_resolution_clock::time_point packStart;
         std::chrono::high_resolution_clock::time_point packEnd;
         string clipboardButtonLabel = ICON_FA_CLIPBOARD " Copy to Clipboard";
+        string headerFile;
+        bool bakeResourceIndices = true;
+        int fontAtlasMainFont = -1;
+        int fontAtlasIconFont = -1;
+        bool fontAtlasScales[std::size(FontAtlas::BakedScales)] = {true, true, true, true, true};
         double lastClickTime = 0.0;
         char editPackedPath[256] = "";
         int editPackedPathIndex = 0;
+        std::string verifyPakPath;
+        PakTypes::PakVerifyResult verifyResult;
+        std::string verifyReport;
+        std::string encryptionReport;
 
         struct Settings {
             int zlibCompressionLevel;
@@ -110,10 +135,22 @@ namespace ResPacker {
             size_t encryptionOpsLimit;
             size_t encryptionMemLimit;
 
+            bool cookImages;
+            bool minifyJson;
+            bool normalizeText;
+
+            bool chunking;
+            bool verifyChecksums;
+            bool merkleTree;
+            bool verifyMerkleTree;
+
+            PakTypes::CipherType cipher;
+
             template<class Archive>
             void serialize(Archive &archive) {
                 archive(zlibCompressionLevel, lz4CompressionLevel, zstdCompressionLevel, encryptionOpsLimit,
-                        encryptionMemLimit);
+                        encryptionMemLimit, cookImages, minifyJson, normalizeText, chunking,
+                        verifyChecksums, merkleTree, verifyMerkleTree, cipher);
             }
         };
 
@@ -0,0 +1,486 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Small JSON document used for the command line tool's job lists and reports. Object members keep their order.
+class Json {
+public:
+    enum Type {
+        NONE,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    using Member = std::pair<std::string, Json>;
+
+    Json() = default;
+
+    Json(bool value) : type(BOOLEAN), boolean(value) {}
+
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+    Json(T value) : type(NUMBER), number(static_cast<double>(value)) {}
+
+    Json(const char *value) : type(STRING), string(value) {}
+
+    Json(std::string value) : type(STRING), string(std::move(value)) {}
+
+    static Json MakeArray() {
+        Json json;
+        json.type = ARRAY;
+        return json;
+    }
+
+    static Json MakeObject() {
+        Json json;
+        json.type = OBJECT;
+        return json;
+    }
+
+    [[nodiscard]] Type getType() const { return type; }
+
+    [[nodiscard]] bool IsNull() const { return type == NONE; }
+
+    [[nodiscard]] bool AsBool() const {
+        Expect(BOOLEAN, "a boolean");
+        return boolean;
+    }
+
+    [[nodiscard]] double AsNumber() const {
+        Expect(NUMBER, "a number");
+        return number;
+    }
+
+    [[nodiscard]] int64_t AsInt() const {
+        Expect(NUMBER, "a number");
+        if (number != std::trunc(number))
+            throw std::runtime_error("JSON value is not an integer");
+        return static_cast<int64_t>(number);
+    }
+
+    [[nodiscard]] const std::string &AsString() const {
+        Expect(STRING, "a string");
+        return string;
+    }
+
+    [[nodiscard]] const std::vector<Json> &AsArray() const {
+        Expect(ARRAY, "an array");
+        return array;
+    }
+
+    [[nodiscard]] const std::vector<Member> &AsObject() const {
+        Expect(OBJECT, "an object");
+        return object;
+    }
+
+    // Returns nullptr when this isn't an object or has no such member
+    [[nodiscard]] const Json *Find(const std::string &key) const {
+        if (type != OBJECT)
+            return nullptr;
+
+        for (const auto &member: object) {
+            if (member.first == key)
+                return &member.second;
+        }
+        return nullptr;
+    }
+
+    // Adds the member when it doesn't exist yet. A null value becomes an empty object first.
+    Json &operator[](const std::string &key) {
+        if (type == NONE)
+            type = OBJECT;
+        Expect(OBJECT, "an object");
+
+        for (auto &member: object) {
+            if (member.first == key)
+                return member.second;
+        }
+        return object.emplace_back(key, Json()).second;
+    }
+
+    void Append(Json value) {
+        if (type == NONE)
+            type = ARRAY;
+        Expect(ARRAY, "an array");
+        array.push_back(std::move(value));
+    }
+
+    static Json Parse(const std::string &text) {
+        size_t position = 0;
+        Json json = ParseValue(text, position, 0);
+
+        SkipWhitespace(text, position);
+        if (position != text.size())
+            throw ParseError("Unexpected trailing characters", position);
+
+        return json;
+    }
+
+    // Pretty prints with the given indent, or on a single line when indent is 0
+    [[nodiscard]] std::string Dump(int indent = 2) const {
+        std::string output;
+        Write(output, indent, 0);
+        return output;
+    }
+
+private:
+    static constexpr int MaxDepth = 256;
+
+    Type type = NONE;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> array;
+    std::vector<Member> object;
+
+    void Expect(Type expected, const char *description) const {
+        if (type != expected)
+            throw std::runtime_error(std::string("JSON value is not ") + description);
+    }
+
+    static std::runtime_error ParseError(const std::string &message, size_t position) {
+        return std::runtime_error(message + " at offset " + std::to_string(position) + " in JSON");
+    }
+
+    static void SkipWhitespace(const std::string &text, size_t &position) {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' ||
+                                          text[position] == '\n' || text[position] == '\r'))
+            position++;
+    }
+
+    static bool Consume(const std::string &text, size_t &position, const char *literal) {
+        size_t length = std::char_traits<char>::length(literal);
+        if (text.compare(position, length, literal) != 0)
+            return false;
+
+        position += length;
+        return true;
+    }
+
+    static Json ParseValue(const std::string &text, size_t &position, int depth) {
+        if (depth > MaxDepth)
+            throw ParseError("Nesting too deep", position);
+
+        SkipWhitespace(text, position);
+        if (position >= text.size())
+            throw ParseError("Unexpected end", position);
+
+        char c = text[position];
+        if (c == '{')
+            return ParseObject(text, position, depth);
+        if (c == '[')
+            return ParseArray(text, position, depth);
+        if (c == '"')
+            return {ParseString(text, position)};
+        if (Consume(text, position, "true"))
+            return {true};
+        if (Consume(text, position, "false"))
+            return {false};
+        if (Consume(text, position, "null"))
+            return {};
+        if (c == '-' || (c >= '0' && c <= '9'))
+            return {ParseNumber(text, position)};
+
+        throw ParseError(std::string("Unexpected character '") + c + "'", position);
+    }
+
+    static Json ParseObject(const std::string &text, size_t &position, int depth) {
+        Json json = MakeObject();
+        position++;
+
+        SkipWhitespace(text, position);
+        if (position < text.size() && text[position] == '}') {
+            position++;
+            return json;
+        }
+
+        while (true) {
+            SkipWhitespace(text, position);
+            if (position >= text.size() || text[position] != '"')
+                throw ParseError("Expected a member name", position);
+
+            std::string key = ParseString(text, position);
+
+            SkipWhitespace(text, position);
+            if (position >= text.size() || text[position] != ':')
+                throw ParseError("Expected ':'", position);
+            position++;
+
+            json[key] = ParseValue(text, position, depth + 1);
+
+            SkipWhitespace(text, position);
+            if (position < text.size() && text[position] == ',') {
+                position++;
+            } else if (position < text.size() && text[position] == '}') {
+                position++;
+                return json;
+            } else {
+                throw ParseError("Expected ',' or '}'", position);
+            }
+        }
+    }
+
+    static Json ParseArray(const std::string &text, size_t &position, int depth) {
+        Json json = MakeArray();
+        position++;
+
+        SkipWhitespace(text, position);
+        if (position < text.size() && text[position] == ']') {
+            position++;
+            return json;
+        }
+
+        while (true) {
+            json.Append(ParseValue(text, position, depth + 1));
+
+            SkipWhitespace(text, position);
+            if (position < text.size() && text[position] == ',') {
+                position++;
+            } else if (position < text.size() && text[position] == ']') {
+                position++;
+                return json;
+            } else {
+                throw ParseError("Expected ',' or ']'", position);
+            }
+        }
+    }
+
+    static double ParseNumber(const std::string &text, size_t &position) {
+        size_t start = position;
+        auto isDigit = [&](size_t i) { return i < text.size() && text[i] >= '0' && text[i] <= '9'; };
+
+        if (text[position] == '-')
+            position++;
+        if (!isDigit(position))
+            throw ParseError("Invalid number", start);
+        while (isDigit(position))
+            position++;
+        if (position < text.size() && text[position] == '.') {
+            position++;
+            if (!isDigit(position))
+                throw ParseError("Invalid number", start);
+            while (isDigit(position))
+                position++;
+        }
+        if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+            position++;
+            if (position < text.size() && (text[position] == '+' || text[position] == '-'))
+                position++;
+            if (!isDigit(position))
+                throw ParseError("Invalid number", start);
+            while (isDigit(position))
+                position++;
+        }
+
+        return std::strtod(text.substr(start, position - start).c_str(), nullptr);
+    }
+
+    static uint32_t ParseHex4(const std::string &text, size_t &position) {
+        if (position + 4 > text.size())
+            throw ParseError("Invalid unicode escape", position);
+
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[position++];
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                value |= c - 'A' + 10;
+            else
+                throw ParseError("Invalid unicode escape", position - 1);
+        }
+        return value;
+    }
+
+    static void AppendUtf8(std::string &output, uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            output += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            output += static_cast<char>(0xC0 | (codePoint >> 6));
+            output += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            output += static_cast<char>(0xE0 | (codePoint >> 12));
+            output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            output += static_cast<char>(0xF0 | (codePoint >> 18));
+            output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            output += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    static std::string ParseString(const std::string &text, size_t &position) {
+        std::string output;
+        position++;
+
+        while (position < text.size() && text[position] != '"') {
+            char c = text[position++];
+            if (static_cast<unsigned char>(c) < 0x20)
+                throw ParseError("Control character in string", position - 1);
+
+            if (c != '\\') {
+                output += c;
+                continue;
+            }
+
+            if (position >= text.size())
+                break;
+
+            char escape = text[position++];
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    output += escape;
+                    break;
+                case 'b':
+                    output += '\b';
+                    break;
+                case 'f':
+                    output += '\f';
+                    break;
+                case 'n':
+                    output += '\n';
+                    break;
+                case 'r':
+                    output += '\r';
+                    break;
+                case 't':
+                    output += '\t';
+                    break;
+                case 'u': {
+                    uint32_t codePoint = ParseHex4(text, position);
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                        if (!Consume(text, position, "\\u"))
+                            throw ParseError("Unpaired surrogate", position);
+                        uint32_t low = ParseHex4(text, position);
+                        if (low < 0xDC00 || low >= 0xE000)
+                            throw ParseError("Unpaired surrogate", position);
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                        throw ParseError("Unpaired surrogate", position);
+                    }
+                    AppendUtf8(output, codePoint);
+                    break;
+                }
+                default:
+                    throw ParseError("Invalid escape", position - 1);
+            }
+        }
+
+        if (position >= text.size())
+            throw ParseError("Unterminated string", position);
+
+        position++;
+        return output;
+    }
+
+    static void WriteString(std::string &output, const std::string &value) {
+        output += '"';
+        for (char c: value) {
+            switch (c) {
+                case '"':
+                    output += "\\\"";
+                    break;
+                case '\\':
+                    output += "\\\\";
+                    break;
+                case '\n':
+                    output += "\\n";
+                    break;
+                case '\r':
+                    output += "\\r";
+                    break;
+                case '\t':
+                    output += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escape[8];
+                        std::snprintf(escape, sizeof escape, "\\u%04x", c);
+                        output += escape;
+                    } else {
+                        output += c;
+                    }
+            }
+        }
+        output += '"';
+    }
+
+    static void WriteNumber(std::string &output, double value) {
+        if (!std::isfinite(value)) {
+            output += "null";
+            return;
+        }
+
+        // Shortest form that reads back as the same double
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof buffer, value);
+        output.append(buffer, result.ptr);
+    }
+
+    static void WriteNewline(std::string &output, int indent, int depth) {
+        if (indent <= 0)
+            return;
+
+        output += '\n';
+        output.append(static_cast<size_t>(indent) * depth, ' ');
+    }
+
+    void Write(std::string &output, int indent, int depth) const {
+        switch (type) {
+            case NONE:
+                output += "null";
+                break;
+            case BOOLEAN:
+                output += boolean ? "true" : "false";
+                break;
+            case NUMBER:
+                WriteNumber(output, number);
+                break;
+            case STRING:
+                WriteString(output, string);
+                break;
+            case ARRAY:
+                output += '[';
+                for (size_t i = 0; i < array.size(); i++) {
+                    if (i > 0)
+                        output += ',';
+                    WriteNewline(output, indent, depth + 1);
+                    array[i].Write(output, indent, depth + 1);
+                }
+                if (!array.empty())
+                    WriteNewline(output, indent, depth);
+                output += ']';
+                break;
+            case OBJECT:
+                output += '{';
+                for (size_t i = 0; i < object.size(); i++) {
+                    if (i > 0)
+                        output += ',';
+                    WriteNewline(output, indent, depth + 1);
+                    WriteString(output, object[i].first);
+                    output += indent > 0 ? ": " : ":";
+                    object[i].second.Write(output, indent, depth + 1);
+                }
+                if (!object.empty())
+                    WriteNewline(output, indent, depth);
+                output += '}';
+                break;
+        }
+    }
+};
@@ -0,0 +1,87 @@
+#include "Kdf.h"
+
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include "PackerConfig.h"
+
+#ifdef USE_ENCRYPTION
+#include "sodium.h"
+#endif
+
+void Kdf::DeriveKey(unsigned char *key, size_t keySize, const std::string &password, const unsigned char *salt,
+                    size_t opsLimit, size_t memLimit) {
+#ifdef USE_ENCRYPTION
+    sodium_init();
+
+    if (crypto_pwhash(key, keySize, password.c_str(), password.size(), salt, opsLimit, memLimit,
+                      crypto_pwhash_ALG_DEFAULT) != 0) {
+        throw std::runtime_error("Key derivation failed");
+    }
+#else
+    throw std::runtime_error("Encryption is not supported");
+#endif
+}
+
+double Kdf::Measure(size_t opsLimit, size_t memLimit) {
+#ifdef USE_ENCRYPTION
+    unsigned char key[crypto_secretbox_xchacha20poly1305_KEYBYTES];
+    unsigned char salt[crypto_pwhash_SALTBYTES]{};
+
+    auto start = std::chrono::steady_clock::now();
+    DeriveKey(key, sizeof key, "password", salt, opsLimit, memLimit);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+#else
+    throw std::runtime_error("Encryption is not supported");
+#endif
+}
+
+Kdf::Limits Kdf::Autotune(double targetSeconds, size_t maxMemLimit) {
+#ifdef USE_ENCRYPTION
+    Limits limits{crypto_pwhash_OPSLIMIT_MIN, crypto_pwhash_MEMLIMIT_MIN};
+    limits.Seconds = Measure(limits.OpsLimit, limits.MemLimit);
+
+    // A step that lands further past the target than the current limits fall short of it is not taken
+    auto closer = [&](double seconds) {
+        return seconds <= targetSeconds || seconds - targetSeconds < targetSeconds - limits.Seconds;
+    };
+
+    while (limits.Seconds < targetSeconds && limits.MemLimit * 2 <= maxMemLimit) {
+        double seconds = Measure(limits.OpsLimit, limits.MemLimit * 2);
+        if (!closer(seconds))
+            return limits;
+
+        limits.MemLimit *= 2;
+        limits.Seconds = seconds;
+    }
+
+    // Derivation time grows roughly linearly with the ops limit
+    while (limits.Seconds < targetSeconds && limits.OpsLimit < crypto_pwhash_OPSLIMIT_MAX) {
+        double estimate = static_cast<double>(limits.OpsLimit) * targetSeconds / limits.Seconds;
+        auto opsLimit = std::max(limits.OpsLimit + 1, static_cast<size_t>(
+                std::min(estimate, static_cast<double>(crypto_pwhash_OPSLIMIT_MAX))));
+        double seconds = Measure(opsLimit, limits.MemLimit);
+        if (!closer(seconds))
+            break;
+
+        limits.OpsLimit = opsLimit;
+        limits.Seconds = seconds;
+    }
+
+    return limits;
+#else
+    throw std::runtime_error("Encryption is not supported");
+#endif
+}
+
+std::vector<Kdf::Limits> Kdf::Benchmark(const std::vector<size_t> &opsLimits, const std::vector<size_t> &memLimits) {
+    std::vector<Limits> results;
+    results.reserve(opsLimits.size() * memLimits.size());
+
+    for (size_t memLimit: memLimits) {
+        for (size_t opsLimit: opsLimits)
+            results.push_back({opsLimit, memLimit, Measure(opsLimit, memLimit)});
+    }
+
+    return results;
+}
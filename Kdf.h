@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Argon2id password key derivation, with helpers to measure what a given cost takes on this machine
+class Kdf {
+public:
+    static constexpr double DefaultTargetSeconds = 0.25;
+    static constexpr size_t DefaultMaxMemLimit = 256 * 1024 * 1024;
+
+    struct Limits {
+        size_t OpsLimit = 0;
+        size_t MemLimit = 0;
+        double Seconds = 0.0;
+    };
+
+    static void DeriveKey(unsigned char *key, size_t keySize, const std::string &password, const unsigned char *salt,
+                          size_t opsLimit, size_t memLimit);
+
+    // Seconds a single derivation with these limits takes on this machine
+    static double Measure(size_t opsLimit, size_t memLimit);
+
+    // Raises the memory limit up to maxMemLimit and then the ops limit until a derivation takes about targetSeconds.
+    // Memory comes first as it is what makes guessing expensive on GPUs.
+    static Limits Autotune(double targetSeconds = DefaultTargetSeconds, size_t maxMemLimit = DefaultMaxMemLimit);
+
+    // Measures every combination of the given limits
+    static std::vector<Limits> Benchmark(const std::vector<size_t> &opsLimits, const std::vector<size_t> &memLimits);
+};
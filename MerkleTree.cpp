@@ -0,0 +1,92 @@
+#include "MerkleTree.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "PackerConfig.h"
+
+#ifdef USE_ENCRYPTION
+#include "sodium.h"
+#endif
+
+namespace {
+    // Prefixes keep a leaf from ever hashing to the same value as an interior node
+    constexpr unsigned char LeafPrefix = 0x00;
+    constexpr unsigned char ParentPrefix = 0x01;
+    constexpr unsigned char PartsPrefix = 0x02;
+}
+
+std::vector<uint64_t> MerkleTree::GetLevelOffsets(size_t dataSize, size_t blockSize) {
+    std::vector<uint64_t> offsets{0};
+
+    size_t levelSize = (dataSize + blockSize - 1) / blockSize;
+    while (levelSize > 0) {
+        offsets.push_back(offsets.back() + levelSize);
+        levelSize = levelSize > 1 ? (levelSize + 1) / 2 : 0;
+    }
+
+    return offsets;
+}
+
+std::vector<MerkleTree::Hash> MerkleTree::Build(const char *data, size_t size, size_t blockSize) {
+    std::vector<uint64_t> levels = GetLevelOffsets(size, blockSize);
+    std::vector<Hash> nodes(levels.back());
+
+    for (size_t offset = 0, i = 0; offset < size; offset += blockSize, i++)
+        nodes[i] = HashLeaf(data + offset, std::min(blockSize, size - offset));
+
+    for (size_t level = 1; level + 1 < levels.size(); level++) {
+        size_t childCount = levels[level] - levels[level - 1];
+        for (size_t i = 0; i < levels[level + 1] - levels[level]; i++) {
+            const Hash &left = nodes[levels[level - 1] + i * 2];
+            const Hash *right = i * 2 + 1 < childCount ? &nodes[levels[level - 1] + i * 2 + 1] : nullptr;
+            nodes[levels[level] + i] = HashParent(left, right);
+        }
+    }
+
+    return nodes;
+}
+
+MerkleTree::Hash MerkleTree::HashLeaf(const char *data, size_t size) {
+    Hash hash{};
+#ifdef USE_ENCRYPTION
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, HashSize);
+    crypto_generichash_update(&state, &LeafPrefix, 1);
+    crypto_generichash_update(&state, reinterpret_cast<const unsigned char *>(data), size);
+    crypto_generichash_final(&state, hash.data(), HashSize);
+#else
+    throw std::runtime_error("Merkle trees are not supported");
+#endif
+    return hash;
+}
+
+MerkleTree::Hash MerkleTree::HashParent(const Hash &left, const Hash *right) {
+    Hash hash{};
+#ifdef USE_ENCRYPTION
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, HashSize);
+    crypto_generichash_update(&state, &ParentPrefix, 1);
+    crypto_generichash_update(&state, left.data(), HashSize);
+    if (right != nullptr)
+        crypto_generichash_update(&state, right->data(), HashSize);
+    crypto_generichash_final(&state, hash.data(), HashSize);
+#else
+    throw std::runtime_error("Merkle trees are not supported");
+#endif
+    return hash;
+}
+
+MerkleTree::Hash MerkleTree::HashParts(std::initializer_list<std::string_view> parts) {
+    Hash hash{};
+#ifdef USE_ENCRYPTION
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, HashSize);
+    crypto_generichash_update(&state, &PartsPrefix, 1);
+    for (std::string_view part: parts)
+        crypto_generichash_update(&state, reinterpret_cast<const unsigned char *>(part.data()), part.size());
+    crypto_generichash_final(&state, hash.data(), HashSize);
+#else
+    throw std::runtime_error("Merkle trees are not supported");
+#endif
+    return hash;
+}
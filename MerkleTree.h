@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <initializer_list>
+
+// Binary hash tree over fixed-size blocks. Leaves are BLAKE2b-256 hashes of each block and parents hash their two
+// children; a trailing odd node is hashed alone. Nodes are stored level by level from the leaves up, so the last node
+// is the root.
+class MerkleTree {
+public:
+    static constexpr size_t HashSize = 32;
+    static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+    using Hash = std::array<unsigned char, HashSize>;
+
+    // Index of the first node of each level, followed by the total node count
+    static std::vector<uint64_t> GetLevelOffsets(size_t dataSize, size_t blockSize);
+
+    static std::vector<Hash> Build(const char *data, size_t size, size_t blockSize);
+
+    static Hash HashLeaf(const char *data, size_t size);
+
+    static Hash HashParent(const Hash &left, const Hash *right);
+
+    // Hashes the parts as one message under its own prefix, for metadata folded into a root next to the data tree
+    static Hash HashParts(std::initializer_list<std::string_view> parts);
+};
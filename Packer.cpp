@@ -4,116 +4,462 @@ bool Packer::CreatePakFile(
         const std::vector<PakTypes::PakFileItem> &files,
         const std::string &targetPath,
         PakTypes::CompressionType compressionType) {
+    ResetStats();
+
     PakTypes::PakHeader header{};
     header.NumEntries = 0;
 
     std::vector<char> dataBuffer;
     std::vector<PakTypes::PakFileTableEntry> fileEntries;
+    ChunkStore chunkStore;
 
     bool hasEncryptedItem = std::any_of(files.begin(), files.end(), [](const PakTypes::PakFileItem &item) {
         return item.encrypted;
     });
 
     if (hasEncryptedItem) {
-        Packer::GenerateEncryptionKey();
-        std::memcpy(header.Salt, salt, crypto_pwhash_SALTBYTES);
+        Packer::GenerateEncryptionKey(header);
+        encryptionCipher = header.Cipher = Cipher::Select(cipher);
     }
 
     for (const auto &file: files) {
-        std::ifstream fileStream(file.path, std::ios::ate | std::ios::binary);
+        PakTypes::PakFileTableEntry pakFileEntry{};
+        std::vector<char> fileData;
 
-        if (!fileStream) {
-            std::cout << "Warning: File not found '" << file.path << "'" << std::endl;
+        if (!LoadFile(file, pakFileEntry, fileData))
             continue;
-        }
 
+        if (!AppendEntry(file, pakFileEntry, fileData, compressionType, dataBuffer, chunkStore))
+            return false;
+
+        fileEntries.push_back(pakFileEntry);
+    }
+
+    FinishPakFile(header, fileEntries, dataBuffer, chunkStore.Chunks, targetPath);
+    return true;
+}
+
+bool Packer::CreatePatchPakFile(
+        const std::vector<PakTypes::PakFileItem> &files,
+        const std::string &basePakPath,
+        const std::string &targetPath,
+        PakTypes::CompressionType compressionType) {
+    ResetStats();
+
+    PakTypes::PakFile basePak = Unpacker::ParsePakFile(basePakPath);
+    if (basePak.Header.BaseBuildId != 0)
+        throw std::runtime_error("Base pak is itself a patch: " + basePakPath);
+
+    Unpacker unpacker = CreateUnpacker();
+
+    PakTypes::PakHeader header{};
+    header.BaseBuildId = basePak.Header.BuildId;
+
+    // Patch entries are encrypted with the base pak's key so a merged pak can reuse either pak's packed data
+    bool baseEncrypted = basePak.Header.KdfOpsLimit != 0;
+    if (baseEncrypted) {
+        std::memcpy(salt, basePak.Header.Salt, crypto_pwhash_SALTBYTES);
+        std::memcpy(header.Salt, salt, crypto_pwhash_SALTBYTES);
+        encryptionCipher = header.Cipher = basePak.Header.Cipher;
+        header.KdfOpsLimit = basePak.Header.KdfOpsLimit;
+        header.KdfMemLimit = basePak.Header.KdfMemLimit;
+    }
+
+    bool hasEncryptedItem = std::any_of(files.begin(), files.end(), [](const PakTypes::PakFileItem &item) {
+        return item.encrypted;
+    });
+
+    // An unencrypted base has no key to share, so the patch gets its own salt and limits
+    if (hasEncryptedItem && baseEncrypted) {
+        DeriveEncryptionKey(header);
+    } else if (hasEncryptedItem) {
+        GenerateEncryptionKey(header);
+        encryptionCipher = header.Cipher = Cipher::Select(cipher);
+    }
+
+    std::vector<char> dataBuffer;
+    std::vector<PakTypes::PakFileTableEntry> fileEntries;
+    ChunkStore chunkStore;
+    std::unordered_set<std::string> packedPaths;
+
+    if (chunking)
+        SeedChunkStore(basePak, chunkStore);
+
+    for (const auto &file: files) {
         PakTypes::PakFileTableEntry pakFileEntry{};
-        pakFileEntry.OriginalSize = static_cast<unsigned int>(fileStream.tellg());
-        std::memcpy(pakFileEntry.FilePath, file.packedPath.c_str(), file.packedPath.length() + 1);
-        pakFileEntry.Offset = static_cast<unsigned int>(dataBuffer.size());
-        pakFileEntry.Compressed = file.compressed;
+        std::vector<char> fileData;
 
-        if (pakFileEntry.Compressed) {
-            pakFileEntry.CompressionType = compressionType;
-        }
+        if (!LoadFile(file, pakFileEntry, fileData))
+            continue;
 
-        fileStream.seekg(0);
+        packedPaths.insert(pakFileEntry.FilePath);
 
-        std::vector<char> fileData(pakFileEntry.OriginalSize);
-        fileStream.read(fileData.data(), pakFileEntry.OriginalSize);
+        if (Unpacker::HasFile(basePak, pakFileEntry.FilePath)) {
+            std::vector<char> reference = unpacker.ExtractFileToMemory(basePak, pakFileEntry.FilePath);
+            if (reference == fileData)
+                continue;
 
-        if (pakFileEntry.Compressed) {
-            std::vector<char> compressedData;
+            if (file.compressed && compressionType == PakTypes::CompressionType::ZSTD && !reference.empty()) {
+                pakFileEntry.PatchType = PakTypes::PatchType::PATCH_DELTA;
+                pakFileEntry.Compressed = true;
+                pakFileEntry.CompressionType = PakTypes::CompressionType::ZSTD;
+                pakFileEntry.Offset = dataBuffer.size();
 
-            if (compressionType == PakTypes::CompressionType::ZLIB) {
-                mz_ulong compressedSize = mz_compressBound(pakFileEntry.OriginalSize);
-                compressedData.resize(compressedSize);
-                int result = mz_compress2(reinterpret_cast<unsigned char *>(compressedData.data()), &compressedSize,
-                                          reinterpret_cast<const unsigned char *>(fileData.data()),
-                                          pakFileEntry.OriginalSize, zlibCompressionLevel);
-                if (result != MZ_OK)
-                    return false;
-                compressedData.resize(compressedSize);
-                if (!file.encrypted) {
-                    pakFileEntry.PackedSize = static_cast<unsigned int>(compressedSize);
-                    dataBuffer.insert(dataBuffer.end(), compressedData.begin(),
-                                      compressedData.begin() + compressedSize);
-                }
-            } else if (compressionType == PakTypes::CompressionType::LZ4) {
-                size_t compressedSize = LZ4_compressBound(pakFileEntry.OriginalSize);
-                compressedData.resize(compressedSize);
-                int compressed_size = LZ4_compress_HC(fileData.data(), compressedData.data(), fileData.size(),
-                                                      compressedData.size(), lz4CompressionLevel);
-                if (compressed_size <= 0)
-                    return false;
-                compressedData.resize(compressed_size);
-                if (!file.encrypted) {
-                    pakFileEntry.PackedSize = static_cast<unsigned int>(compressed_size);
-                    dataBuffer.insert(dataBuffer.end(), compressedData.begin(),
-                                      compressedData.begin() + compressed_size);
-                }
-            } else if (compressionType == PakTypes::CompressionType::ZSTD) {
-                size_t compressedSize = ZSTD_compressBound(pakFileEntry.OriginalSize);
-                compressedData.resize(compressedSize);
-                size_t compressed_size = ZSTD_compress(compressedData.data(), compressedData.size(), fileData.data(),
-                                                       fileData.size(), zstdCompressionLevel);
-                if (ZSTD_isError(compressed_size))
+                auto compressStart = std::chrono::steady_clock::now();
+                dataBuffer.resize(pakFileEntry.Offset + (file.encrypted ? GetEncryptionHeadroom() : 0));
+                if (!CompressDelta(reference, fileData, dataBuffer))
                     return false;
-                compressedData.resize(compressed_size);
-                if (!file.encrypted) {
-                    pakFileEntry.PackedSize = static_cast<unsigned int>(compressed_size);
-                    dataBuffer.insert(dataBuffer.end(), compressedData.begin(),
-                                      compressedData.begin() + compressed_size);
+                stats.CompressSeconds += SecondsSince(compressStart);
+
+                if (file.encrypted) {
+                    auto encryptStart = std::chrono::steady_clock::now();
+                    Packer::Encrypt(pakFileEntry, dataBuffer);
+                    stats.EncryptSeconds += SecondsSince(encryptStart);
                 }
-            } else {
-                throw std::invalid_argument("Unknown compression type");
+
+                pakFileEntry.PackedSize = dataBuffer.size() - pakFileEntry.Offset;
+                fileEntries.push_back(pakFileEntry);
+                continue;
             }
+        }
+
+        if (!AppendEntry(file, pakFileEntry, fileData, compressionType, dataBuffer, chunkStore))
+            return false;
+
+        fileEntries.push_back(pakFileEntry);
+    }
+
+    Unpacker::ForEachEntry(basePak, [&](size_t, const PakTypes::PakFileTableEntry &entry) {
+        if (packedPaths.contains(entry.FilePath))
+            return;
+
+        PakTypes::PakFileTableEntry removedEntry{};
+        std::memcpy(removedEntry.FilePath, entry.FilePath, sizeof(removedEntry.FilePath));
+        removedEntry.PatchType = PakTypes::PatchType::PATCH_REMOVE;
+        removedEntry.Offset = dataBuffer.size();
+        fileEntries.push_back(removedEntry);
+    });
+
+    FinishPakFile(header, fileEntries, dataBuffer, chunkStore.Chunks, targetPath);
+    return true;
+}
+
+bool Packer::ApplyPatchPakFile(const std::string &basePakPath, const std::string &patchPakPath,
+                               const std::string &targetPath) {
+    ResetStats();
 
-            if (file.encrypted) {
-                Packer::Encrypt(compressedData);
-                pakFileEntry.PackedSize = static_cast<unsigned int>(compressedData.size());
-                pakFileEntry.Encrypted = true;
-                dataBuffer.insert(dataBuffer.end(), compressedData.begin(),
-                                  compressedData.begin() + compressedData.size());
+    PakTypes::PakFile basePak = Unpacker::ParsePakFile(basePakPath);
+    PakTypes::PakFile patchPak = Unpacker::ParsePakFile(patchPakPath);
+    Unpacker::VerifyPatch(basePak, patchPak);
+
+    Unpacker unpacker = CreateUnpacker();
+
+    // Encrypted patch entries share the base pak's key, or carry the patch's own when the base is unencrypted
+    const PakTypes::PakHeader &keyHeader = basePak.Header.KdfOpsLimit != 0 ? basePak.Header : patchPak.Header;
+
+    PakTypes::PakHeader header{};
+    std::memcpy(salt, keyHeader.Salt, crypto_pwhash_SALTBYTES);
+    std::memcpy(header.Salt, salt, crypto_pwhash_SALTBYTES);
+    encryptionCipher = header.Cipher = keyHeader.Cipher;
+    header.KdfOpsLimit = keyHeader.KdfOpsLimit;
+    header.KdfMemLimit = keyHeader.KdfMemLimit;
+
+    bool keyDerived = false;
+    std::vector<char> dataBuffer;
+    std::vector<PakTypes::PakFileTableEntry> fileEntries;
+    ChunkStore chunkStore;
+
+    auto appendPacked = [&](PakTypes::PakFile &pakFile, size_t entryIndex) {
+        PakTypes::PakFileTableEntry entry = Unpacker::GetEntry(pakFile, entryIndex);
+        entry.PatchType = PakTypes::PatchType::PATCH_REPLACE;
+
+        // Chunk references point into the source pak's chunk table, or the base pak's for a patch, so chunked entries
+        // are stored again
+        if (entry.Chunked) {
+            std::vector<char> fileData = &pakFile == &patchPak
+                                         ? unpacker.ExtractPatchedFile(basePak, patchPak, entry.FilePath)
+                                         : unpacker.ExtractFileToMemory(pakFile, entry.FilePath);
+            if (!AppendChunks(entry, GetCompressionLevel(entry.CompressionType), fileData, dataBuffer, chunkStore))
+                return false;
+            fileEntries.push_back(entry);
+            return true;
+        }
+
+        std::vector<char> packedData = Unpacker::ReadPackedEntry(pakFile, entryIndex);
+
+        entry.Offset = dataBuffer.size();
+        dataBuffer.insert(dataBuffer.end(), packedData.begin(), packedData.end());
+        fileEntries.push_back(entry);
+        return true;
+    };
+
+    bool result = true;
+    Unpacker::ForEachEntry(basePak, [&](size_t baseIndex, const PakTypes::PakFileTableEntry &baseEntry) {
+        if (!result)
+            return;
+
+        if (!Unpacker::HasFile(patchPak, baseEntry.FilePath)) {
+            result = appendPacked(basePak, baseIndex);
+            return;
+        }
+
+        size_t patchIndex = Unpacker::FindEntryIndex(patchPak, baseEntry.FilePath);
+        PakTypes::PakFileTableEntry patchEntry = Unpacker::GetEntry(patchPak, patchIndex);
+
+        if (patchEntry.PatchType == PakTypes::PatchType::PATCH_REPLACE) {
+            result = appendPacked(patchPak, patchIndex);
+        } else if (patchEntry.PatchType == PakTypes::PatchType::PATCH_DELTA) {
+            std::vector<char> fileData = unpacker.ExtractPatchedFile(basePak, patchPak, baseEntry.FilePath);
+
+            patchEntry.PatchType = PakTypes::PatchType::PATCH_REPLACE;
+            patchEntry.Offset = dataBuffer.size();
+
+            dataBuffer.resize(patchEntry.Offset + (patchEntry.Encrypted ? GetEncryptionHeadroom() : 0));
+            if (!Compress(PakTypes::CompressionType::ZSTD, zstdCompressionLevel, fileData.data(), fileData.size(),
+                          dataBuffer)) {
+                result = false;
+                return;
             }
-        } else {
-            pakFileEntry.PackedSize = pakFileEntry.OriginalSize;
 
-            if (file.encrypted) {
-                Packer::Encrypt(fileData);
-                pakFileEntry.PackedSize = static_cast<unsigned int>(fileData.size());
-                pakFileEntry.Encrypted = true;
+            if (patchEntry.Encrypted) {
+                if (!keyDerived) {
+                    DeriveEncryptionKey(header);
+                    keyDerived = true;
+                }
+                Packer::Encrypt(patchEntry, dataBuffer);
             }
 
-            dataBuffer.insert(dataBuffer.end(), fileData.begin(), fileData.end());
+            patchEntry.PackedSize = dataBuffer.size() - patchEntry.Offset;
+            fileEntries.push_back(patchEntry);
         }
+    });
 
-        fileEntries.push_back(pakFileEntry);
-        fileStream.close();
+    if (!result)
+        return false;
+
+    Unpacker::ForEachEntry(patchPak, [&](size_t patchIndex, const PakTypes::PakFileTableEntry &patchEntry) {
+        if (result && patchEntry.PatchType == PakTypes::PatchType::PATCH_REPLACE &&
+            !Unpacker::HasFile(basePak, patchEntry.FilePath))
+            result = appendPacked(patchPak, patchIndex);
+    });
+
+    if (!result)
+        return false;
+
+    FinishPakFile(header, fileEntries, dataBuffer, chunkStore.Chunks, targetPath);
+    return true;
+}
+
+bool Packer::LoadFile(const PakTypes::PakFileItem &file, PakTypes::PakFileTableEntry &pakFileEntry,
+                      std::vector<char> &fileData) {
+    auto loadStart = std::chrono::steady_clock::now();
+    std::ifstream fileStream(file.path, std::ios::ate | std::ios::binary);
+
+    if (!fileStream) {
+        std::cerr << "Warning: File not found '" << file.path << "'" << std::endl;
+        return false;
     }
 
+    pakFileEntry.OriginalSize = static_cast<unsigned int>(fileStream.tellg());
+    std::memcpy(pakFileEntry.FilePath, file.packedPath.c_str(), file.packedPath.length() + 1);
+
+    fileStream.seekg(0);
+
+    fileData.resize(pakFileEntry.OriginalSize);
+    fileStream.read(fileData.data(), static_cast<std::streamsize>(pakFileEntry.OriginalSize));
+
+    stats.LoadSeconds += SecondsSince(loadStart);
+
+    pakFileEntry.CookType = cooker.GetCookType(file.path);
+    if (pakFileEntry.CookType != PakTypes::CookType::NONE) {
+        auto cookStart = std::chrono::steady_clock::now();
+        fileData = cooker.Cook(pakFileEntry.CookType, fileData, file.path);
+        pakFileEntry.OriginalSize = fileData.size();
+        stats.CookSeconds += SecondsSince(cookStart);
+    }
+
+    pakFileEntry.Checksum = Checksum::Crc32c(fileData.data(), fileData.size());
+
+    return true;
+}
+
+bool Packer::AppendEntry(const PakTypes::PakFileItem &file, PakTypes::PakFileTableEntry &pakFileEntry,
+                         std::vector<char> &fileData, PakTypes::CompressionType compressionType,
+                         std::vector<char> &dataBuffer, ChunkStore &chunkStore) {
+    auto compressStart = std::chrono::steady_clock::now();
+    CompressionRule rule = GetCompressionRule(file.path, compressionType);
+
+    pakFileEntry.Offset = dataBuffer.size();
+    pakFileEntry.Compressed = file.compressed && rule.Compressed;
+
+    if (pakFileEntry.Compressed) {
+        pakFileEntry.CompressionType = rule.Type;
+    }
+
+    if (chunking && !file.encrypted && file.filter == PakTypes::FilterType::UNFILTERED) {
+        bool appended = AppendChunks(pakFileEntry, rule.Level, fileData, dataBuffer, chunkStore);
+        stats.CompressSeconds += SecondsSince(compressStart);
+        return appended;
+    }
+
+    if (pakFileEntry.Compressed && file.filter != PakTypes::FilterType::UNFILTERED) {
+        if (!Filters::IsValidElementSize(file.elementSize))
+            throw std::runtime_error("Invalid filter element size for file: " + file.path);
+
+        pakFileEntry.FilterType = file.filter;
+        pakFileEntry.ElementSize = file.elementSize;
+        fileData = Filters::Apply(file.filter, file.elementSize, fileData);
+    }
+
+    // Packed data is written straight into the data buffer, after room for the nonce and MAC when encrypting
+    dataBuffer.resize(pakFileEntry.Offset + (file.encrypted ? GetEncryptionHeadroom() : 0));
+
+    if (pakFileEntry.Compressed) {
+        if (seekableBlockSize > 0 && pakFileEntry.OriginalSize > seekableBlockSize) {
+            pakFileEntry.BlockSize = seekableBlockSize;
+            if (!CompressBlocks(rule.Type, rule.Level, fileData, seekableBlockSize, dataBuffer))
+                return false;
+        } else if (!Compress(rule.Type, rule.Level, fileData.data(), fileData.size(), dataBuffer)) {
+            return false;
+        }
+    } else {
+        dataBuffer.insert(dataBuffer.end(), fileData.begin(), fileData.end());
+    }
+
+    stats.CompressSeconds += SecondsSince(compressStart);
+
+    if (file.encrypted) {
+        auto encryptStart = std::chrono::steady_clock::now();
+        Packer::Encrypt(pakFileEntry, dataBuffer);
+        stats.EncryptSeconds += SecondsSince(encryptStart);
+    }
+
+    pakFileEntry.PackedSize = dataBuffer.size() - pakFileEntry.Offset;
+
+    return true;
+}
+
+bool Packer::AppendChunks(PakTypes::PakFileTableEntry &pakFileEntry, int level, const std::vector<char> &fileData,
+                          std::vector<char> &dataBuffer, ChunkStore &chunkStore) {
+    sodium_init();
+
+    std::vector<uint64_t> chunkIndices;
+    size_t offset = 0;
+
+    for (size_t length: chunker.Split(fileData.data(), fileData.size())) {
+        const char *chunkData = fileData.data() + offset;
+        offset += length;
+
+        std::string hash(sizeof(PakTypes::PakChunkEntry::Hash), '\0');
+        crypto_generichash(reinterpret_cast<unsigned char *>(hash.data()), hash.size(),
+                           reinterpret_cast<const unsigned char *>(chunkData), length, nullptr, 0);
+
+        auto [chunkIndex, inserted] = chunkStore.Index.try_emplace(hash, chunkStore.Chunks.size());
+        chunkIndices.push_back(chunkIndex->second);
+        if (!inserted) {
+            stats.ReusedChunks++;
+            continue;
+        }
+
+        PakTypes::PakChunkEntry chunk{};
+        std::memcpy(chunk.Hash, hash.data(), hash.size());
+        chunk.Offset = dataBuffer.size();
+        chunk.OriginalSize = static_cast<uint32_t>(length);
+
+        if (pakFileEntry.Compressed) {
+            std::vector<char> compressedData;
+            if (!Compress(pakFileEntry.CompressionType, level, chunkData, length, compressedData))
+                return false;
+
+            if (compressedData.size() < length) {
+                chunk.Compressed = true;
+                chunk.CompressionType = pakFileEntry.CompressionType;
+                dataBuffer.insert(dataBuffer.end(), compressedData.begin(), compressedData.end());
+            }
+        }
+
+        if (!chunk.Compressed)
+            dataBuffer.insert(dataBuffer.end(), chunkData, chunkData + length);
+
+        chunk.PackedSize = static_cast<uint32_t>(dataBuffer.size() - chunk.Offset);
+        chunkStore.Chunks.push_back(chunk);
+        stats.NewChunks++;
+    }
+
+    pakFileEntry.Chunked = true;
+    pakFileEntry.BlockSize = 0;
+    pakFileEntry.Offset = dataBuffer.size();
+    pakFileEntry.PackedSize = chunkIndices.size() * sizeof(uint64_t);
+
+    const char *indexData = reinterpret_cast<const char *>(chunkIndices.data());
+    dataBuffer.insert(dataBuffer.end(), indexData, indexData + pakFileEntry.PackedSize);
+    return true;
+}
+
+void Packer::SeedChunkStore(const PakTypes::PakFile &basePak, ChunkStore &chunkStore) {
+    for (size_t i = 0; i < basePak.Chunks.size(); i++) {
+        std::string hash(reinterpret_cast<const char *>(basePak.Chunks[i].Hash), sizeof(PakTypes::PakChunkEntry::Hash));
+        chunkStore.Index.try_emplace(hash, i | PakTypes::BaseChunkFlag);
+    }
+}
+
+void Packer::WritePakFile(PakTypes::PakHeader &header, std::vector<PakTypes::PakFileTableEntry> &fileEntries,
+                          const std::vector<char> &dataBuffer, std::vector<PakTypes::PakChunkEntry> &chunks,
+                          size_t merkleBlockSize, const std::string &targetPath) {
     header.NumEntries = static_cast<unsigned int>(fileEntries.size());
 
+    const size_t baseOffset = PakTypes::GetDataOffset(fileEntries.size());
+
+    std::vector<PakTypes::PakLookupEntry> lookup(fileEntries.size());
+
+    for (size_t i = 0; i < fileEntries.size(); i++) {
+        PakTypes::PakFileTableEntry &e = fileEntries[i];
+        e.Offset += baseOffset;
+        lookup[i] = {PakTypes::HashPath(e.FilePath), i};
+    }
+
+    std::sort(lookup.begin(), lookup.end(), [](const PakTypes::PakLookupEntry &a, const PakTypes::PakLookupEntry &b) {
+        return a.PathHash < b.PathHash || (a.PathHash == b.PathHash && a.EntryIndex < b.EntryIndex);
+    });
+
+    for (size_t i = 1; i < lookup.size(); i++) {
+        if (lookup[i].PathHash != lookup[i - 1].PathHash)
+            continue;
+
+        std::string_view previousPath = fileEntries[lookup[i - 1].EntryIndex].FilePath;
+        if (previousPath != fileEntries[lookup[i].EntryIndex].FilePath) {
+            throw std::runtime_error("Path hash collision between '" + std::string(previousPath) + "' and '" +
+                                     fileEntries[lookup[i].EntryIndex].FilePath + "'");
+        }
+    }
+
+    for (auto &chunk: chunks)
+        chunk.Offset += baseOffset;
+
+    if (!chunks.empty()) {
+        header.ChunkTableOffset = baseOffset + dataBuffer.size();
+        header.NumChunks = chunks.size();
+    }
+
+    std::vector<MerkleTree::Hash> merkleNodes;
+    if (merkleBlockSize > 0 && !dataBuffer.empty()) {
+        merkleNodes = MerkleTree::Build(dataBuffer.data(), dataBuffer.size(), merkleBlockSize);
+        header.MerkleTreeOffset = baseOffset + dataBuffer.size() + chunks.size() * sizeof(PakTypes::PakChunkEntry);
+        header.MerkleBlockSize = merkleBlockSize;
+    }
+
+    header.BuildId = ComputeBuildId(fileEntries);
+
+    if (!merkleNodes.empty()) {
+        MerkleTree::Hash tableHash = PakTypes::HashTables(
+                header,
+                {reinterpret_cast<const char *>(fileEntries.data()), fileEntries.size() * sizeof(PakTypes::PakFileTableEntry)},
+                {reinterpret_cast<const char *>(lookup.data()), lookup.size() * sizeof(PakTypes::PakLookupEntry)},
+                {reinterpret_cast<const char *>(chunks.data()), chunks.size() * sizeof(PakTypes::PakChunkEntry)});
+        std::memcpy(header.MerkleRoot, MerkleTree::HashParent(merkleNodes.back(), &tableHash).data(),
+                    MerkleTree::HashSize);
+    }
+
     std::ofstream output(targetPath, std::ios::binary);
     if (!output) {
         throw std::runtime_error("Failed to open output file: " + targetPath);
@@ -124,16 +470,14 @@ bool Packer::CreatePakFile(
         throw std::runtime_error("Failed to write header to output file: " + targetPath);
     }
 
-    const unsigned int baseOffset =
-            sizeof(PakTypes::PakHeader) +
-            static_cast<unsigned int>(fileEntries.size()) * sizeof(PakTypes::PakFileTableEntry);
+    output.write(reinterpret_cast<const char *>(fileEntries.data()), fileEntries.size() * sizeof(PakTypes::PakFileTableEntry));
+    if (!output) {
+        throw std::runtime_error("Failed to write file entries to output file: " + targetPath);
+    }
 
-    for (PakTypes::PakFileTableEntry &e: fileEntries) {
-        e.Offset += baseOffset;
-        output.write(reinterpret_cast<const char *>(&e), sizeof(PakTypes::PakFileTableEntry));
-        if (!output) {
-            throw std::runtime_error("Failed to write file entry to output file: " + targetPath);
-        }
+    output.write(reinterpret_cast<const char *>(lookup.data()), lookup.size() * sizeof(PakTypes::PakLookupEntry));
+    if (!output) {
+        throw std::runtime_error("Failed to write lookup table to output file: " + targetPath);
     }
 
     output.write(dataBuffer.data(), dataBuffer.size());
@@ -141,47 +485,188 @@ bool Packer::CreatePakFile(
         throw std::runtime_error("Failed to write data buffer to output file: " + targetPath);
     }
 
+    output.write(reinterpret_cast<const char *>(chunks.data()), chunks.size() * sizeof(PakTypes::PakChunkEntry));
+    if (!output) {
+        throw std::runtime_error("Failed to write chunk table to output file: " + targetPath);
+    }
+
+    output.write(reinterpret_cast<const char *>(merkleNodes.data()), merkleNodes.size() * MerkleTree::HashSize);
+    if (!output) {
+        throw std::runtime_error("Failed to write Merkle tree to output file: " + targetPath);
+    }
+
     output.close();
     if (!output) {
         throw std::runtime_error("Failed to close output file: " + targetPath);
     }
+}
+
+bool Packer::Compress(PakTypes::CompressionType compressionType, int level, const char *data, size_t size,
+                      std::vector<char> &output) const {
+    size_t outputOffset = output.size();
+
+    if (compressionType == PakTypes::CompressionType::ZLIB) {
+        mz_ulong compressedSize = mz_compressBound(size);
+        output.resize(outputOffset + compressedSize);
+        int result = mz_compress2(reinterpret_cast<unsigned char *>(output.data() + outputOffset), &compressedSize,
+                                  reinterpret_cast<const unsigned char *>(data), size, level);
+        if (result != MZ_OK)
+            return false;
+        output.resize(outputOffset + compressedSize);
+    } else if (compressionType == PakTypes::CompressionType::LZ4) {
+        int compressedBound = LZ4_compressBound(static_cast<int>(size));
+        output.resize(outputOffset + compressedBound);
+        int compressed_size = LZ4_compress_HC(data, output.data() + outputOffset, static_cast<int>(size),
+                                              compressedBound, level);
+        if (compressed_size <= 0)
+            return false;
+        output.resize(outputOffset + compressed_size);
+    } else if (compressionType == PakTypes::CompressionType::ZSTD) {
+        size_t compressedBound = ZSTD_compressBound(size);
+        output.resize(outputOffset + compressedBound);
+        size_t compressed_size = ZSTD_compress(output.data() + outputOffset, compressedBound, data, size, level);
+        if (ZSTD_isError(compressed_size))
+            return false;
+        output.resize(outputOffset + compressed_size);
+    } else {
+        throw std::invalid_argument("Unknown compression type");
+    }
+
+    return true;
+}
+
+uint64_t Packer::ComputeBuildId(const std::vector<PakTypes::PakFileTableEntry> &fileEntries) {
+    uint64_t buildId = PakTypes::HashCombine(PakTypes::HashPath("PAK"), fileEntries.size());
+
+    for (const auto &e: fileEntries) {
+        buildId = PakTypes::HashCombine(buildId, PakTypes::HashPath(e.FilePath));
+        buildId = PakTypes::HashCombine(buildId, e.OriginalSize);
+        buildId = PakTypes::HashCombine(buildId, e.PackedSize);
+        buildId = PakTypes::HashCombine(buildId, e.Offset);
+        buildId = PakTypes::HashCombine(buildId, e.BlockSize);
+        buildId = PakTypes::HashCombine(buildId, e.Checksum);
+        buildId = PakTypes::HashCombine(buildId, e.Compressed | e.Encrypted << 1 | e.CompressionType << 2 | e.CookType << 4 |
+                                        e.FilterType << 6 | static_cast<uint64_t>(e.ElementSize) << 8 |
+                                        static_cast<uint64_t>(e.PatchType) << 40 | static_cast<uint64_t>(e.Chunked) << 48);
+    }
+
+    return buildId != 0 ? buildId : 1;
+}
+
+bool Packer::CompressBlocks(PakTypes::CompressionType compressionType, int level, const std::vector<char> &data,
+                            size_t blockSize, std::vector<char> &output) const {
+    size_t blockCount = PakTypes::GetBlockCount(data.size(), blockSize);
+    std::vector<uint64_t> blockOffsets(blockCount + 1);
+    size_t tableSize = blockOffsets.size() * sizeof(uint64_t);
+    size_t tableOffset = output.size();
+
+    output.resize(tableOffset + tableSize);
+
+    for (size_t i = 0; i < blockCount; i++) {
+        size_t blockStart = i * blockSize;
+        size_t blockLength = std::min(blockSize, data.size() - blockStart);
+
+        if (!Compress(compressionType, level, data.data() + blockStart, blockLength, output))
+            return false;
+
+        blockOffsets[i + 1] = output.size() - tableOffset - tableSize;
+    }
+
+    std::memcpy(output.data() + tableOffset, blockOffsets.data(), tableSize);
+    return true;
+}
+
+bool Packer::CompressDelta(const std::vector<char> &reference, const std::vector<char> &data,
+                           std::vector<char> &output) const {
+    ZSTD_CCtx *context = ZSTD_createCCtx();
+    if (context == nullptr)
+        return false;
+
+    // The window has to reach back over the whole reference, and long distance matching finds edits far into it
+    int windowLog = std::clamp(static_cast<int>(std::bit_width(reference.size() + data.size())), MinDeltaWindowLog,
+                               MaxDeltaWindowLog);
+
+    ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, zstdCompressionLevel);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_windowLog, windowLog);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_enableLongDistanceMatching, 1);
+    ZSTD_CCtx_refPrefix(context, reference.data(), reference.size());
+
+    size_t outputOffset = output.size();
+    output.resize(outputOffset + ZSTD_compressBound(data.size()));
+    size_t compressedSize = ZSTD_compress2(context, output.data() + outputOffset, output.size() - outputOffset,
+                                           data.data(), data.size());
+    ZSTD_freeCCtx(context);
+
+    if (ZSTD_isError(compressedSize))
+        return false;
 
+    output.resize(outputOffset + compressedSize);
     return true;
 }
 
-void Packer::GenerateEncryptionKey() {
+Unpacker Packer::CreateUnpacker() const {
+    Unpacker unpacker;
+    unpacker.setThreadPool(threadPool);
+#ifdef USE_ENCRYPTION
+    std::string pwd = password;
+    unpacker.setPassword(pwd);
+    unpacker.setEncryptionOpsLimit(encryptionOpsLimit);
+    unpacker.setEncryptionMemLimit(encryptionMemLimit);
+#endif
+    return unpacker;
+}
+
+void Packer::GenerateEncryptionKey(PakTypes::PakHeader &header) {
     sodium_init();
 
     randombytes_buf(salt, sizeof salt);
+    std::memcpy(header.Salt, salt, crypto_pwhash_SALTBYTES);
+    header.KdfOpsLimit = encryptionOpsLimit;
+    header.KdfMemLimit = encryptionMemLimit;
 
-    if (crypto_pwhash(key, sizeof key, password.c_str(), password.size(), salt,
-                      encryptionOpsLimit, encryptionMemLimit,
-                      crypto_pwhash_ALG_DEFAULT) != 0) {
-        throw std::exception("Key derivation failed");
-    }
+    DeriveEncryptionKey(header);
 }
 
-void Packer::Encrypt(std::vector<char> &dataBuffer) const {
-    size_t message_len = dataBuffer.size();
+void Packer::DeriveEncryptionKey(const PakTypes::PakHeader &header) {
+    auto keyStart = std::chrono::steady_clock::now();
+    Kdf::DeriveKey(key, sizeof key, password, salt, header.KdfOpsLimit, header.KdfMemLimit);
+    stats.KeySeconds += SecondsSince(keyStart);
+}
 
-    unsigned char nonce[crypto_secretbox_xchacha20poly1305_NONCEBYTES];
-    randombytes_buf(nonce, sizeof nonce);
+void Packer::Encrypt(PakTypes::PakFileTableEntry &entry, std::vector<char> &dataBuffer) const {
+    entry.Encrypted = true;
+    entry.EncryptionBlockSize = static_cast<uint32_t>(encryptionBlockSize);
 
-    auto *ciphertext = new unsigned char[message_len + crypto_secretbox_xchacha20poly1305_MACBYTES];
+    auto *nonce = reinterpret_cast<unsigned char *>(dataBuffer.data() + entry.Offset);
+    randombytes_buf(nonce, crypto_secretbox_xchacha20poly1305_NONCEBYTES);
 
-    if (crypto_secretbox_xchacha20poly1305_easy(ciphertext, reinterpret_cast<const unsigned char *>(dataBuffer.data()),
-                                                message_len, nonce, key) != 0) {
-        throw std::exception("Encryption failed");
+    if (encryptionBlockSize == 0) {
+        auto *mac = nonce + crypto_secretbox_xchacha20poly1305_NONCEBYTES;
+        auto *message = mac + crypto_secretbox_xchacha20poly1305_MACBYTES;
+
+        Cipher::Seal(encryptionCipher, key, nonce, message,
+                     dataBuffer.size() - entry.Offset - PakTypes::EncryptionOverhead, message, mac);
+        return;
     }
 
-    dataBuffer.clear();
-    dataBuffer.resize(
-            message_len + crypto_secretbox_xchacha20poly1305_NONCEBYTES + crypto_secretbox_xchacha20poly1305_MACBYTES);
-    std::memcpy(dataBuffer.data(), nonce, sizeof nonce);
-    std::memcpy(dataBuffer.data() + sizeof nonce, ciphertext,
-                message_len + crypto_secretbox_xchacha20poly1305_MACBYTES);
+    size_t dataOffset = entry.Offset + crypto_secretbox_xchacha20poly1305_NONCEBYTES;
+    size_t size = dataBuffer.size() - dataOffset;
+    size_t segments = std::max<size_t>(1, (size + encryptionBlockSize - 1) / encryptionBlockSize);
+
+    // The MACs follow the ciphertext so segment boundaries line up with the packed data's own offsets
+    std::vector<unsigned char> macs(segments * crypto_secretbox_xchacha20poly1305_MACBYTES);
+    unsigned char segmentNonce[crypto_secretbox_xchacha20poly1305_NONCEBYTES];
+
+    for (size_t i = 0; i < segments; i++) {
+        auto *message = reinterpret_cast<unsigned char *>(dataBuffer.data() + dataOffset + i * encryptionBlockSize);
+        size_t length = std::min(encryptionBlockSize, size - i * encryptionBlockSize);
 
-    delete[] ciphertext;
+        Cipher::GetSegmentNonce(encryptionCipher, nonce, i, i + 1 == segments, segmentNonce);
+        Cipher::Seal(encryptionCipher, key, segmentNonce, message, length, message,
+                     macs.data() + i * crypto_secretbox_xchacha20poly1305_MACBYTES);
+    }
+
+    dataBuffer.insert(dataBuffer.end(), macs.begin(), macs.end());
 }
 
 const char *Packer::CompressionTypeToString(PakTypes::CompressionType type) {
@@ -196,3 +681,53 @@ const char *Packer::CompressionTypeToString(PakTypes::CompressionType type) {
             return "Unknown";
     }
 }
+
+void Packer::AddCompressionRule(const std::string &extension, const CompressionRule &rule) {
+    compressionRules[Cooker::NormalizeExtension(extension)] = rule;
+}
+
+Packer::CompressionRule Packer::GetCompressionRule(const std::string &path,
+                                                   PakTypes::CompressionType compressionType) const {
+    auto rule = compressionRules.find(Cooker::NormalizeExtension(std::filesystem::path(path).extension().string()));
+    if (rule != compressionRules.end())
+        return rule->second;
+
+    return {true, compressionType, GetCompressionLevel(compressionType)};
+}
+
+int Packer::GetCompressionLevel(PakTypes::CompressionType compressionType) const {
+    switch (compressionType) {
+        case PakTypes::CompressionType::ZLIB:
+            return zlibCompressionLevel;
+        case PakTypes::CompressionType::LZ4:
+            return lz4CompressionLevel;
+        case PakTypes::CompressionType::ZSTD:
+            return zstdCompressionLevel;
+        default:
+            throw std::invalid_argument("Unknown compression type");
+    }
+}
+
+void Packer::FinishPakFile(PakTypes::PakHeader &header, std::vector<PakTypes::PakFileTableEntry> &fileEntries,
+                           const std::vector<char> &dataBuffer, std::vector<PakTypes::PakChunkEntry> &chunks,
+                           const std::string &targetPath) {
+    auto writeStart = std::chrono::steady_clock::now();
+    WritePakFile(header, fileEntries, dataBuffer, chunks, merkleTree ? merkleBlockSize : 0, targetPath);
+    stats.WriteSeconds = SecondsSince(writeStart);
+
+    stats.Entries = fileEntries.size();
+    for (const auto &entry: fileEntries)
+        stats.OriginalBytes += entry.OriginalSize;
+    stats.PackedBytes = dataBuffer.size();
+    stats.PakBytes = std::filesystem::file_size(targetPath);
+    stats.Seconds = SecondsSince(statsStart);
+}
+
+void Packer::ResetStats() {
+    stats = {};
+    statsStart = std::chrono::steady_clock::now();
+}
+
+double Packer::SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -3,10 +3,26 @@
 #include <utility>
 #include <vector>
 #include <string>
+#include <cstring>
+#include <stdexcept>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <bit>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
 #include "PakTypes.h"
+#include "Cooker.h"
+#include "Filters.h"
+#include "Chunker.h"
+#include "Checksum.h"
+#include "MerkleTree.h"
+#include "Cipher.h"
+#include "Kdf.h"
+#include "Unpacker.h"
+#include "ThreadPool.h"
 #include "External/miniz/miniz.h"
 #include "lz4hc.h"
 #include "zstd.h"
@@ -20,10 +36,50 @@ public:
             PakTypes::CompressionType compressionType = PakTypes::CompressionType::ZSTD
     );
 
-    void Encrypt(std::vector<char> &dataBuffer) const;
+    // Writes only the entries that differ from the base pak. Changed entries are zstd compressed against the base
+    // copy when possible and files missing from the list are recorded as removed. With chunking on, chunks the base
+    // pak already stores are referenced there instead of being stored again.
+    [[nodiscard]] bool CreatePatchPakFile(
+            const std::vector<PakTypes::PakFileItem> &files,
+            const std::string &basePakPath,
+            const std::string &targetPath,
+            PakTypes::CompressionType compressionType = PakTypes::CompressionType::ZSTD
+    );
+
+    // Materializes a standalone pak from a base pak and a patch created against it
+    [[nodiscard]] bool ApplyPatchPakFile(
+            const std::string &basePakPath,
+            const std::string &patchPakPath,
+            const std::string &targetPath
+    );
+
+    // Encrypts the entry's packed data in place, from GetEncryptionHeadroom() bytes past entry.Offset to the end of
+    // dataBuffer, and fills the headroom with the nonce (and MAC for unsegmented entries)
+    void Encrypt(PakTypes::PakFileTableEntry &entry, std::vector<char> &dataBuffer) const;
+
+    [[nodiscard]] size_t GetEncryptionHeadroom() const {
+        return encryptionBlockSize > 0 ? crypto_secretbox_xchacha20poly1305_NONCEBYTES : PakTypes::EncryptionOverhead;
+    }
 
     static const char *CompressionTypeToString(PakTypes::CompressionType type);
 
+    struct CompressionRule {
+        bool Compressed = true;
+        PakTypes::CompressionType Type = PakTypes::CompressionType::ZSTD;
+        int Level = 0;
+    };
+
+    // Overrides the pak's codec and level for files with this extension. A rule with Compressed set to false stores
+    // matching files uncompressed.
+    void AddCompressionRule(const std::string &extension, const CompressionRule &rule);
+
+    void ClearCompressionRules() { compressionRules.clear(); }
+
+    [[nodiscard]] CompressionRule GetCompressionRule(const std::string &path,
+                                                     PakTypes::CompressionType compressionType) const;
+
+    [[nodiscard]] int GetCompressionLevel(PakTypes::CompressionType compressionType) const;
+
     [[nodiscard]] int getZlibCompressionLevel() const { return zlibCompressionLevel; }
 
     void setZlibCompressionLevel(int level) { zlibCompressionLevel = level; }
@@ -36,6 +92,10 @@ public:
 
     void setZstdCompressionLevel(int level) { zstdCompressionLevel = level; }
 
+    [[nodiscard]] size_t getSeekableBlockSize() const { return seekableBlockSize; }
+
+    void setSeekableBlockSize(size_t size) { seekableBlockSize = size; }
+
     [[nodiscard]] size_t getEncryptionOpsLimit() const { return encryptionOpsLimit; }
 
     void setEncryptionOpsLimit(size_t limit) { encryptionOpsLimit = limit; }
@@ -44,21 +104,130 @@ public:
 
     void setEncryptionMemLimit(size_t limit) { encryptionMemLimit = limit; }
 
+    // Encrypted entries are sealed in segments of this size so they can be read without decrypting them whole.
+    // 0 seals each entry as a single message.
+    [[nodiscard]] size_t getEncryptionBlockSize() const { return encryptionBlockSize; }
+
+    void setEncryptionBlockSize(size_t size) { encryptionBlockSize = size; }
+
+    // Preferred cipher for new paks. Falls back to XChaCha20-Poly1305 when this machine can't run it.
+    // Patches always use their base pak's cipher.
+    [[nodiscard]] PakTypes::CipherType getCipher() const { return cipher; }
+
+    void setCipher(PakTypes::CipherType type) { cipher = type; }
+
     [[nodiscard]] std::string getPassword() const { return password; }
 
     void setPassword(std::string &pwd) { password = pwd; }
 
+    [[nodiscard]] Cooker &getCooker() { return cooker; }
+
+    [[nodiscard]] bool getChunking() const { return chunking; }
+
+    void setChunking(bool enabled) { chunking = enabled; }
+
+    [[nodiscard]] const Chunker &getChunker() const { return chunker; }
+
+    void setChunker(const Chunker &value) { chunker = value; }
+
+    // Stores a Merkle tree over the data region so readers can verify just the blocks they load
+    [[nodiscard]] bool getMerkleTree() const { return merkleTree; }
+
+    void setMerkleTree(bool enabled) { merkleTree = enabled; }
+
+    [[nodiscard]] size_t getMerkleBlockSize() const { return merkleBlockSize; }
+
+    void setMerkleBlockSize(size_t size) { merkleBlockSize = size; }
+
+    // Pool used by the unpacker that reads base paks. Defaults to ThreadPool::Shared().
+    [[nodiscard]] ThreadPool &getThreadPool() const { return threadPool ? *threadPool : ThreadPool::Shared(); }
+
+    void setThreadPool(ThreadPool *pool) { threadPool = pool; }
+
+    // Timings and sizes of the last CreatePakFile, CreatePatchPakFile or ApplyPatchPakFile call
+    [[nodiscard]] const PakTypes::PakPackStats &getStats() const { return stats; }
+
 private:
     int zlibCompressionLevel = MZ_BEST_COMPRESSION;
     int lz4CompressionLevel = 8;
     int zstdCompressionLevel = 8;
 
+    size_t seekableBlockSize = 256 * 1024;
+
+    Cooker cooker;
+    std::unordered_map<std::string, CompressionRule> compressionRules;
+
+    bool chunking = false;
+    Chunker chunker;
+
+    bool merkleTree = false;
+    size_t merkleBlockSize = MerkleTree::DefaultBlockSize;
+
+    struct ChunkStore {
+        std::vector<PakTypes::PakChunkEntry> Chunks;
+        std::unordered_map<std::string, uint64_t> Index;
+    };
+
     size_t encryptionOpsLimit = crypto_pwhash_OPSLIMIT_MIN;
     size_t encryptionMemLimit = crypto_pwhash_MEMLIMIT_MIN;
+    size_t encryptionBlockSize = 64 * 1024;
+    PakTypes::CipherType cipher = PakTypes::CipherType::XCHACHA20_POLY1305;
+    PakTypes::CipherType encryptionCipher = PakTypes::CipherType::XCHACHA20_POLY1305;
+
+    static constexpr int MinDeltaWindowLog = 10;
+    static constexpr int MaxDeltaWindowLog = 27;
+
+    ThreadPool *threadPool = nullptr;
+
+    PakTypes::PakPackStats stats;
+    std::chrono::steady_clock::time_point statsStart;
 
     std::string password;
     unsigned char salt[crypto_pwhash_SALTBYTES];
     unsigned char key[crypto_secretbox_xchacha20poly1305_KEYBYTES];
 
-    void GenerateEncryptionKey();
+    bool Compress(PakTypes::CompressionType compressionType, int level, const char *data, size_t size,
+                  std::vector<char> &output) const;
+
+    bool CompressBlocks(PakTypes::CompressionType compressionType, int level, const std::vector<char> &data,
+                        size_t blockSize, std::vector<char> &output) const;
+
+    bool CompressDelta(const std::vector<char> &reference, const std::vector<char> &data,
+                       std::vector<char> &output) const;
+
+    bool LoadFile(const PakTypes::PakFileItem &file, PakTypes::PakFileTableEntry &pakFileEntry,
+                  std::vector<char> &fileData);
+
+    bool AppendEntry(const PakTypes::PakFileItem &file, PakTypes::PakFileTableEntry &pakFileEntry,
+                     std::vector<char> &fileData, PakTypes::CompressionType compressionType,
+                     std::vector<char> &dataBuffer, ChunkStore &chunkStore);
+
+    // Stores the entry as references to deduplicated chunks, compressed when the entry is compressed
+    bool AppendChunks(PakTypes::PakFileTableEntry &pakFileEntry, int level, const std::vector<char> &fileData,
+                      std::vector<char> &dataBuffer, ChunkStore &chunkStore);
+
+    // Indexes the base pak's chunks so matching chunks become BaseChunkFlag references
+    static void SeedChunkStore(const PakTypes::PakFile &basePak, ChunkStore &chunkStore);
+
+    static void WritePakFile(PakTypes::PakHeader &header, std::vector<PakTypes::PakFileTableEntry> &fileEntries,
+                             const std::vector<char> &dataBuffer, std::vector<PakTypes::PakChunkEntry> &chunks,
+                             size_t merkleBlockSize, const std::string &targetPath);
+
+    // Writes the pak and records its sizes and the write and total times in stats
+    void FinishPakFile(PakTypes::PakHeader &header, std::vector<PakTypes::PakFileTableEntry> &fileEntries,
+                       const std::vector<char> &dataBuffer, std::vector<PakTypes::PakChunkEntry> &chunks,
+                       const std::string &targetPath);
+
+    void ResetStats();
+
+    static double SecondsSince(std::chrono::steady_clock::time_point start);
+
+    static uint64_t ComputeBuildId(const std::vector<PakTypes::PakFileTableEntry> &fileEntries);
+
+    [[nodiscard]] Unpacker CreateUnpacker() const;
+
+    // Picks a new salt and records it and the KDF limits in the header before deriving the key
+    void GenerateEncryptionKey(PakTypes::PakHeader &header);
+
+    void DeriveEncryptionKey(const PakTypes::PakHeader &header);
 };
\ No newline at end of file
@@ -1,19 +1,30 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
 
 #include "PackerConfig.h"
+#include "MerkleTree.h"
 
 #ifdef USE_ENCRYPTION
 #include <sodium.h>
 #endif
 
+class EntryCache;
+
 class PakTypes {
 public:
-    static constexpr auto PAK_FILE_VERSION = 1;
+    static constexpr auto PAK_FILE_VERSION = 14;
     static constexpr auto CompressionCount = 3;
+    static constexpr auto FilterCount = 4;
+    static constexpr uint64_t BaseChunkFlag = 1ull << 63;
 
     enum CompressionType {
         ZLIB,
@@ -21,6 +32,50 @@ public:
         ZSTD
     };
 
+    // Ids from CUSTOM upwards are free for transforms registered with Cooker::RegisterTransform
+    enum CookType {
+        NONE,
+        IMAGE_RGBA,
+        JSON_MINIFY,
+        TEXT_NORMALIZE,
+        CUSTOM = 0x100
+    };
+
+    // DELTA and XOR_DELTA difference each element against the previous one and then byte shuffle the result
+    enum FilterType {
+        UNFILTERED,
+        SHUFFLE,
+        DELTA,
+        XOR_DELTA
+    };
+
+    // Patch paks only store changed entries. PATCH_DELTA entries are zstd frames compressed against the base
+    // pak's copy of the file, PATCH_REMOVE entries mark files deleted since the base build.
+    enum PatchType {
+        PATCH_REPLACE,
+        PATCH_DELTA,
+        PATCH_REMOVE
+    };
+
+    enum CipherType {
+        XCHACHA20_POLY1305,
+        AES256_GCM
+    };
+
+#ifdef USE_ENCRYPTION
+    // Encrypted data is stored as nonce, MAC, ciphertext, using the pak's cipher. Entries with an EncryptionBlockSize are sealed in segments
+    // of that size instead and stored as nonce, ciphertext, one MAC per segment, so they can be decrypted piecewise.
+    static constexpr size_t EncryptionOverhead = crypto_secretbox_xchacha20poly1305_NONCEBYTES +
+                                                 crypto_secretbox_xchacha20poly1305_MACBYTES;
+#endif
+
+    struct CookedImageHeader {
+        char ID[4] = {"IMG"};
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t Channels = 4;
+    };
+
     struct PakHeader {
         char ID[4] = {"PAK"};
         unsigned int Version = PAK_FILE_VERSION;
@@ -30,24 +85,220 @@ public:
         unsigned char Salt[0];
 #endif
         size_t NumEntries = 0;
+        uint64_t BuildId = 0;
+        uint64_t BaseBuildId = 0;
+        uint64_t ChunkTableOffset = 0;
+        uint64_t NumChunks = 0;
+        // Optional Merkle tree over the data region, stored after the chunk table. MerkleRoot is the parent of the
+        // tree's root and HashTables, so it also covers the header and tables.
+        uint64_t MerkleTreeOffset = 0;
+        uint64_t MerkleBlockSize = 0;
+        unsigned char MerkleRoot[MerkleTree::HashSize]{};
+        CipherType Cipher = XCHACHA20_POLY1305;
+        // Argon2id limits the key was derived with, 0 when nothing is encrypted
+        uint64_t KdfOpsLimit = 0;
+        uint64_t KdfMemLimit = 0;
     };
 
     struct PakFileTableEntry {
         char FilePath[255]{};
         bool Compressed = false;
         bool Encrypted = false;
-        CompressionType CompressionType{};
+        bool Chunked = false;
+        PakTypes::CompressionType CompressionType{};
+        PakTypes::CookType CookType{};
+        PakTypes::FilterType FilterType{};
+        uint32_t ElementSize = 0;
+        PakTypes::PatchType PatchType{};
+        uint32_t Checksum = 0;
+        uint32_t EncryptionBlockSize = 0;
         size_t OriginalSize = 0;
         size_t PackedSize = 0;
         size_t Offset = 0;
+        size_t BlockSize = 0;
+    };
+
+    // Chunked entries store a list of uint64_t chunk indices instead of their data. Each unique chunk is stored once
+    // and the chunk table follows the data region. In a patch, indices with BaseChunkFlag set point into the base
+    // pak's chunk table.
+    struct PakChunkEntry {
+        unsigned char Hash[16]{};
+        uint64_t Offset = 0;
+        uint32_t OriginalSize = 0;
+        uint32_t PackedSize = 0;
+        bool Compressed = false;
+        PakTypes::CompressionType CompressionType{};
+    };
+
+    struct PakLookupEntry {
+        uint64_t PathHash = 0;
+        uint64_t EntryIndex = 0;
+    };
+
+    struct ResourceId {
+        uint64_t PathHash = 0;
+        uint64_t BuildId = 0;
+        uint64_t EntryIndex = 0;
+        uint64_t Offset = 0;
+    };
+
+    struct PakEntryInfo {
+        size_t Index = 0;
+        size_t OriginalSize = 0;
+        size_t PackedSize = 0;
+        bool Compressed = false;
+        bool Encrypted = false;
+        bool Chunked = false;
+        PakTypes::CompressionType CompressionType{};
+        PakTypes::CookType CookType{};
+        PakTypes::FilterType FilterType{};
+        uint32_t ElementSize = 0;
+        uint32_t Checksum = 0;
+    };
+
+    struct PakVerifyResult {
+        size_t EntriesChecked = 0;
+        size_t EntriesSkipped = 0;
+        uint64_t OriginalBytes = 0;
+        uint64_t PackedBytes = 0;
+        double Seconds = 0.0;
+        std::vector<std::string> Errors;
+    };
+
+    // Filled in by each Packer run. OriginalBytes is measured after cooking, PackedBytes is the data region.
+    struct PakPackStats {
+        size_t Entries = 0;
+        uint64_t OriginalBytes = 0;
+        uint64_t PackedBytes = 0;
+        uint64_t PakBytes = 0;
+        double KeySeconds = 0.0;
+        double LoadSeconds = 0.0;
+        double CookSeconds = 0.0;
+        double CompressSeconds = 0.0;
+        double EncryptSeconds = 0.0;
+        double WriteSeconds = 0.0;
+        double Seconds = 0.0;
+        // Chunks stored by this pak, and references served by a chunk already in it or in a patch's base pak
+        size_t NewChunks = 0;
+        size_t ReusedChunks = 0;
+    };
+
+    // Time an Unpacker thread spent in each stage of its reads while read timings are collected. Stages are
+    // exclusive, so I/O done during a lookup counts as I/O.
+    struct PakReadTimings {
+        double LookupSeconds = 0.0;
+        double IoSeconds = 0.0;
+        double DecryptSeconds = 0.0;
+        double DecompressSeconds = 0.0;
+        double VerifySeconds = 0.0;
     };
 
     struct PakFile {
         PakHeader Header;
         std::vector<PakFileTableEntry> FileEntries;
+        std::vector<PakChunkEntry> Chunks;
         std::ifstream File;
+        const char *Memory = nullptr;
+        size_t MemorySize = 0;
+        std::shared_ptr<EntryCache> Cache;
+
+        // Entries decoded by OpenAsync, each handed to the first read of it and then dropped
+        std::unordered_map<size_t, std::shared_ptr<const std::vector<char>>> Prefetched;
+
+        bool Lazy = false;
+        std::vector<PakLookupEntry> Lookup;
+        std::unordered_map<size_t, std::vector<PakFileTableEntry>> EntryPages;
+        std::unordered_map<size_t, std::vector<PakLookupEntry>> LookupPages;
+
+        // Merkle tree level offsets and the nodes verified so far, seeded with the data root the header's root covers
+        std::vector<uint64_t> MerkleLevels;
+        std::unordered_map<uint64_t, MerkleTree::Hash> MerkleNodes;
     };
 
+    static constexpr uint64_t HashPath(std::string_view path) {
+        return HashBytes(path);
+    }
+
+    static constexpr uint64_t HashBytes(std::string_view bytes) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (char c: bytes) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    static constexpr uint64_t HashCombine(uint64_t hash, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // Hash of the header with MerkleRoot zeroed, followed by the entry, lookup and chunk tables
+    static MerkleTree::Hash HashTables(const PakHeader &header, std::string_view entries, std::string_view lookup,
+                                       std::string_view chunks) {
+        char headerBytes[sizeof(PakHeader)];
+        std::memcpy(headerBytes, &header, sizeof(PakHeader));
+        std::memset(headerBytes + offsetof(PakHeader, MerkleRoot), 0, MerkleTree::HashSize);
+        return MerkleTree::HashParts({std::string_view(headerBytes, sizeof(headerBytes)), entries, lookup, chunks});
+    }
+
+    static constexpr size_t GetEntryTableOffset() {
+        return sizeof(PakHeader);
+    }
+
+    static constexpr size_t GetLookupTableOffset(size_t numEntries) {
+        return GetEntryTableOffset() + numEntries * sizeof(PakFileTableEntry);
+    }
+
+    static constexpr size_t GetDataOffset(size_t numEntries) {
+        return GetLookupTableOffset(numEntries) + numEntries * sizeof(PakLookupEntry);
+    }
+
+    static constexpr size_t GetDataEnd(const PakHeader &header, size_t pakSize) {
+        if (header.NumChunks > 0)
+            return header.ChunkTableOffset;
+        return header.MerkleTreeOffset > 0 ? header.MerkleTreeOffset : pakSize;
+    }
+
+#ifdef USE_ENCRYPTION
+    // Expects PackedSize to be at least EncryptionOverhead
+    static constexpr size_t GetEncryptedSegmentCount(const PakFileTableEntry &entry) {
+        if (entry.EncryptionBlockSize == 0)
+            return 1;
+        return (entry.PackedSize - crypto_secretbox_xchacha20poly1305_NONCEBYTES + entry.EncryptionBlockSize +
+                crypto_secretbox_xchacha20poly1305_MACBYTES - 1) /
+               (entry.EncryptionBlockSize + crypto_secretbox_xchacha20poly1305_MACBYTES);
+    }
+
+    // Size of an encrypted entry's data once the nonce and MACs are removed
+    static constexpr size_t GetDecryptedSize(const PakFileTableEntry &entry) {
+        return entry.PackedSize - crypto_secretbox_xchacha20poly1305_NONCEBYTES -
+               GetEncryptedSegmentCount(entry) * crypto_secretbox_xchacha20poly1305_MACBYTES;
+    }
+
+    static constexpr bool IsValidEncryptedSize(const PakFileTableEntry &entry) {
+        if (entry.PackedSize < EncryptionOverhead)
+            return false;
+        if (entry.EncryptionBlockSize == 0)
+            return true;
+
+        // Every segment but the last is full and the last is not empty unless it is the only one
+        size_t segments = GetEncryptedSegmentCount(entry);
+        return segments == 1 || GetDecryptedSize(entry) > (segments - 1) * entry.EncryptionBlockSize;
+    }
+#endif
+
+    static constexpr size_t GetBlockCount(size_t originalSize, size_t blockSize) {
+        return (originalSize + blockSize - 1) / blockSize;
+    }
+
+    static constexpr size_t GetBlockTableSize(size_t originalSize, size_t blockSize) {
+        return (GetBlockCount(originalSize, blockSize) + 1) * sizeof(uint64_t);
+    }
+
     struct PakFileItem {
         std::string name;
         std::string path;
@@ -55,5 +306,7 @@ public:
         size_t size = 0;
         bool compressed = false;
         bool encrypted = false;
+        FilterType filter = UNFILTERED;
+        uint32_t elementSize = 4;
     };
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cereal/types/vector.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/archives/binary.hpp>
+#include "PakTypes.h"
+
+// A .pakproj file, saved by the GUI and packed by the GUI or the command line tool
+struct ProjectFile {
+    // Version 2 added the filter and element size of each file
+    static constexpr unsigned int CurrentVersion = 2;
+
+    unsigned int version = CurrentVersion;
+    PakTypes::CompressionType compressionType = PakTypes::CompressionType::ZSTD;
+    std::vector<PakTypes::PakFileItem> files;
+
+    static ProjectFile Load(const std::string &path);
+
+    void Save(const std::string &path) const;
+};
+
+namespace cereal {
+    template<class Archive>
+    void save(Archive &archive, const ProjectFile &project) {
+        archive(project.version, project.compressionType, make_size_tag(static_cast<size_type>(project.files.size())));
+        for (const auto &item: project.files) {
+            archive(item.name, item.path, item.packedPath, item.size, item.compressed, item.encrypted, item.filter,
+                    item.elementSize);
+        }
+    }
+
+    template<class Archive>
+    void load(Archive &archive, ProjectFile &project) {
+        size_type count;
+        archive(project.version, project.compressionType, make_size_tag(count));
+
+        project.files.resize(static_cast<size_t>(count));
+        for (auto &item: project.files) {
+            archive(item.name, item.path, item.packedPath, item.size, item.compressed, item.encrypted);
+            if (project.version >= 2)
+                archive(item.filter, item.elementSize);
+        }
+    }
+}
+
+inline ProjectFile ProjectFile::Load(const std::string &path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is)
+        throw std::runtime_error("Failed to open project file: " + path);
+
+    ProjectFile project;
+    {
+        cereal::BinaryInputArchive archive(is);
+        archive(project);
+    }
+
+    if (project.version == 0 || project.version > CurrentVersion)
+        throw std::runtime_error("Invalid project file version");
+
+    return project;
+}
+
+inline void ProjectFile::Save(const std::string &path) const {
+    std::ofstream os(path, std::ios::binary);
+    if (!os)
+        throw std::runtime_error("Failed to create project file: " + path);
+
+    cereal::BinaryOutputArchive archive(os);
+    archive(*this);
+}
@@ -0,0 +1,144 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <algorithm>
+
+namespace {
+    std::atomic<uint64_t> nextBatch{1};
+
+    // Tasks submitted from the same running task, or from the same thread outside the pool, share a batch
+    thread_local uint64_t currentBatch = 0;
+
+    uint64_t GetCurrentBatch() {
+        if (currentBatch == 0)
+            currentBatch = nextBatch.fetch_add(1);
+        return currentBatch;
+    }
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0)
+        threadCount = 1;
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto &worker: workers)
+        worker.join();
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task) {
+    std::packaged_task<void()> packagedTask(std::move(task));
+    std::future<void> future = packagedTask.get_future();
+
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back({std::move(packagedTask), GetCurrentBatch()});
+    }
+    condition.notify_one();
+
+    return future;
+}
+
+void ThreadPool::Wait(std::future<void> &future) {
+    // Only this batch is helped with: its tasks are either queued, and run here, or running on another thread.
+    uint64_t batch = GetCurrentBatch();
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!RunPendingTask(batch))
+            future.wait();
+    }
+
+    future.get();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)> &body) {
+    if (count == 0)
+        return;
+
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    auto worker = [next, count, &body]() {
+        for (size_t i = next->fetch_add(1); i < count; i = next->fetch_add(1))
+            body(i);
+    };
+
+    std::vector<std::future<void>> futures;
+    size_t helpers = std::min(count, workers.size()) - 1;
+    futures.reserve(helpers);
+    for (size_t i = 0; i < helpers; i++)
+        futures.push_back(Submit(worker));
+
+    std::exception_ptr error;
+    try {
+        worker();
+    } catch (...) {
+        error = std::current_exception();
+        next->store(count);
+    }
+
+    for (auto &future: futures) {
+        try {
+            Wait(future);
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+            next->store(count);
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+ThreadPool &ThreadPool::Shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+bool ThreadPool::RunPendingTask(uint64_t batch) {
+    Task task;
+    {
+        std::lock_guard lock(mutex);
+        auto it = std::find_if(tasks.begin(), tasks.end(), [batch](const Task &queued) {
+            return queued.batch == batch;
+        });
+        if (it == tasks.end())
+            return false;
+        task = std::move(*it);
+        tasks.erase(it);
+    }
+
+    RunTask(task);
+    return true;
+}
+
+void ThreadPool::RunTask(Task &task) {
+    uint64_t outerBatch = currentBatch;
+    currentBatch = nextBatch.fetch_add(1);
+    task.work();
+    currentBatch = outerBatch;
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        RunTask(task);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mutex>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::future<void> Submit(std::function<void()> task);
+
+    // While waiting, runs queued tasks that were submitted by the caller's own task (or thread), so nested waits
+    // can't starve the pool and unrelated work never runs on the waiter's stack.
+    void Wait(std::future<void> &future);
+
+    void ParallelFor(size_t count, const std::function<void(size_t)> &body);
+
+    [[nodiscard]] size_t getThreadCount() const { return workers.size(); }
+
+    static ThreadPool &Shared();
+
+private:
+    struct Task {
+        std::packaged_task<void()> work;
+        uint64_t batch = 0;
+    };
+
+    bool RunPendingTask(uint64_t batch);
+
+    static void RunTask(Task &task);
+
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
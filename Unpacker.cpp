@@ -1,85 +1,440 @@
 #include "Unpacker.h"
+#include <atomic>
+
+namespace {
+    struct DecompressionContext {
+        std::vector<char> packedBuffer;
+        std::vector<char> decryptedBuffer;
+        std::vector<char> blockBuffer;
+        std::vector<char> filterBuffer;
+        std::vector<char> verifyBuffer;
+        std::vector<char> authBuffer;
+        const char *reference = nullptr;
+        size_t referenceSize = 0;
+        PakTypes::PakFile *chunkBase = nullptr;
+#ifdef USE_ZSTD
+        ZSTD_DCtx *zstd = nullptr;
+#endif
+#ifdef USE_ZLIB
+        mz_stream zlib{};
+        bool zlibInitialised = false;
+#endif
+
+        DecompressionContext() = default;
+        DecompressionContext(const DecompressionContext &) = delete;
+        DecompressionContext &operator=(const DecompressionContext &) = delete;
+
+        ~DecompressionContext() {
+#ifdef USE_ZSTD
+            ZSTD_freeDCtx(zstd);
+#endif
+#ifdef USE_ZLIB
+            if (zlibInitialised)
+                mz_inflateEnd(&zlib);
+#endif
+        }
+    };
+
+    thread_local DecompressionContext context;
+
+    std::atomic<bool> collectReadTimings{false};
+    thread_local PakTypes::PakReadTimings readTimings;
+
+    using ReadStage = double PakTypes::PakReadTimings::*;
+    thread_local ReadStage activeStage = nullptr;
+    thread_local std::chrono::steady_clock::time_point activeStageStart;
+
+    // Adds the time until it goes out of scope to one stage of this thread's read timings. A nested timer pauses
+    // the enclosing one.
+    class StageTimer {
+    public:
+        explicit StageTimer(ReadStage stage) {
+            if (!collectReadTimings.load(std::memory_order_relaxed))
+                return;
+
+            enabled = true;
+            outer = activeStage;
+            Switch(stage);
+        }
+
+        StageTimer(const StageTimer &) = delete;
+        StageTimer &operator=(const StageTimer &) = delete;
+
+        ~StageTimer() {
+            if (enabled)
+                Switch(outer);
+        }
+
+    private:
+        static void Switch(ReadStage stage) {
+            auto now = std::chrono::steady_clock::now();
+            if (activeStage != nullptr)
+                readTimings.*activeStage += std::chrono::duration<double>(now - activeStageStart).count();
+            activeStage = stage;
+            activeStageStart = now;
+        }
+
+        bool enabled = false;
+        ReadStage outer = nullptr;
+    };
+
+    char *ReserveScratch(std::vector<char> &buffer, size_t size) {
+        if (buffer.size() < size)
+            buffer.resize(size);
+        return buffer.data();
+    }
+
+    // Scratch grown past this is released when the read that needed it finishes, so one large entry doesn't pin
+    // that much memory on every thread that ever decoded it.
+    constexpr size_t MaxRetainedScratch = 8 * 1024 * 1024;
+
+    thread_local int scratchDepth = 0;
+
+    void ReleaseLargeScratch(std::vector<char> &buffer) {
+        if (buffer.capacity() > MaxRetainedScratch)
+            std::vector<char>().swap(buffer);
+    }
+
+    // Marks a top level read. Scratch is only trimmed when the outermost one ends, since nested reads and tasks
+    // helped by ThreadPool::Wait can still be holding pointers into it.
+    struct ScratchScope {
+        ScratchScope() { scratchDepth++; }
+
+        ScratchScope(const ScratchScope &) = delete;
+        ScratchScope &operator=(const ScratchScope &) = delete;
+
+        ~ScratchScope() {
+            if (--scratchDepth > 0)
+                return;
+
+            ReleaseLargeScratch(context.packedBuffer);
+            ReleaseLargeScratch(context.decryptedBuffer);
+            ReleaseLargeScratch(context.blockBuffer);
+            ReleaseLargeScratch(context.filterBuffer);
+            ReleaseLargeScratch(context.verifyBuffer);
+            ReleaseLargeScratch(context.authBuffer);
+        }
+    };
+
+    struct ReferenceScope {
+        explicit ReferenceScope(const std::vector<char> &reference) {
+            context.reference = reference.data();
+            context.referenceSize = reference.size();
+        }
+
+        ReferenceScope(const ReferenceScope &) = delete;
+        ReferenceScope &operator=(const ReferenceScope &) = delete;
+
+        ~ReferenceScope() {
+            context.reference = nullptr;
+            context.referenceSize = 0;
+        }
+    };
+
+    // Lets chunk lists read on this thread resolve BaseChunkFlag references into a patch's base pak
+    struct ChunkBaseScope {
+        explicit ChunkBaseScope(PakTypes::PakFile &basePak) : previous(context.chunkBase) {
+            context.chunkBase = &basePak;
+        }
+
+        ChunkBaseScope(const ChunkBaseScope &) = delete;
+        ChunkBaseScope &operator=(const ChunkBaseScope &) = delete;
+
+        ~ChunkBaseScope() {
+            context.chunkBase = previous;
+        }
+
+    private:
+        PakTypes::PakFile *previous;
+    };
+}
 
 std::vector<char> Unpacker::ExtractFileToMemory(PakTypes::PakFile& pakFile, const std::string& filePath) {
-    bool hasEncryptedItem = std::any_of(pakFile.FileEntries.begin(), pakFile.FileEntries.end(),
-                                        [](const PakTypes::PakFileTableEntry &item) {
-                                            return item.Encrypted;
-                                        });
-#ifdef USE_ENCRYPTION
-    if (hasEncryptedItem) {
-        memcpy(salt, pakFile.Header.Salt, crypto_pwhash_SALTBYTES);
-        Unpacker::GenerateEncryptionKey();
+    size_t entryIndex = FindEntryIndex(pakFile, filePath);
+
+    if (pakFile.Cache) {
+        EntryCache::Buffer cached = ExtractCachedEntry(pakFile, entryIndex);
+        return *cached;
     }
-#else
-    if (hasEncryptedItem)
-        throw std::runtime_error("Encryption is not supported");
-#endif
 
-    auto fileEntryIt = std::find_if(pakFile.FileEntries.begin(), pakFile.FileEntries.end(),
-                                    [&filePath](const PakTypes::PakFileTableEntry &entry) {
-                                        return std::string(entry.FilePath) == filePath;
-                                    });
+    std::vector<char> buffer(GetEntry(pakFile, entryIndex).OriginalSize);
+    ExtractIndexedEntry(pakFile, entryIndex, buffer.data());
+
+    return buffer;
+}
 
-    if (fileEntryIt != pakFile.FileEntries.end()) {
-        const PakTypes::PakFileTableEntry &entry = *fileEntryIt;
+size_t Unpacker::ExtractFileToMemory(PakTypes::PakFile &pakFile, const std::string &filePath,
+                                     std::span<std::byte> destination) {
+    size_t entryIndex = FindEntryIndex(pakFile, filePath);
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
 
-        pakFile.File.seekg(entry.Offset);
+    if (destination.size() < entry.OriginalSize)
+        throw std::length_error("Destination buffer is too small for file: " + filePath);
 
-        std::vector<char> dataBuffer(entry.PackedSize);
-        pakFile.File.read(dataBuffer.data(), dataBuffer.size());
+    ExtractIndexedEntry(pakFile, entryIndex, reinterpret_cast<char *>(destination.data()));
 
-#ifdef USE_ENCRYPTION
-        if (entry.Encrypted) {
-            Decrypt(dataBuffer);
+    return entry.OriginalSize;
+}
+
+std::span<std::byte> Unpacker::ExtractFileToMemory(PakTypes::PakFile &pakFile, const std::string &filePath,
+                                                   const Allocator &allocator) {
+    size_t entryIndex = FindEntryIndex(pakFile, filePath);
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
+
+    std::byte *destination = allocator(entry.OriginalSize);
+    if (destination == nullptr && entry.OriginalSize > 0)
+        throw std::bad_alloc();
+
+    ExtractIndexedEntry(pakFile, entryIndex, reinterpret_cast<char *>(destination));
+
+    return {destination, entry.OriginalSize};
+}
+
+EntryCache::Buffer Unpacker::ExtractSharedFile(PakTypes::PakFile &pakFile, const std::string &filePath) {
+    size_t entryIndex = FindEntryIndex(pakFile, filePath);
+
+    if (pakFile.Cache)
+        return ExtractCachedEntry(pakFile, entryIndex);
+
+    if (EntryCache::Buffer prefetched = TakePrefetched(pakFile, entryIndex))
+        return prefetched;
+
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
+
+    auto buffer = std::make_shared<std::vector<char>>(entry.OriginalSize);
+    ExtractEntry(pakFile, entry, buffer->data());
+
+    return buffer;
+}
+
+std::vector<char> Unpacker::ExtractFileToMemory(PakTypes::PakFile &pakFile, const PakTypes::ResourceId &resourceId) {
+    size_t entryIndex = FindEntryIndex(pakFile, resourceId);
+
+    if (pakFile.Cache)
+        return *ExtractCachedEntry(pakFile, entryIndex);
+
+    std::vector<char> buffer(GetEntry(pakFile, entryIndex).OriginalSize);
+    ExtractIndexedEntry(pakFile, entryIndex, buffer.data());
+
+    return buffer;
+}
+
+size_t Unpacker::ExtractFileToMemory(PakTypes::PakFile &pakFile, const PakTypes::ResourceId &resourceId,
+                                     std::span<std::byte> destination) {
+    size_t entryIndex = FindEntryIndex(pakFile, resourceId);
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
+
+    if (destination.size() < entry.OriginalSize)
+        throw std::length_error(std::string("Destination buffer is too small for file: ") + entry.FilePath);
+
+    ExtractIndexedEntry(pakFile, entryIndex, reinterpret_cast<char *>(destination.data()));
+
+    return entry.OriginalSize;
+}
+
+EntryCache::Buffer Unpacker::ExtractSharedFile(PakTypes::PakFile &pakFile, const PakTypes::ResourceId &resourceId) {
+    size_t entryIndex = FindEntryIndex(pakFile, resourceId);
+
+    if (pakFile.Cache)
+        return ExtractCachedEntry(pakFile, entryIndex);
+
+    if (EntryCache::Buffer prefetched = TakePrefetched(pakFile, entryIndex))
+        return prefetched;
+
+    auto buffer = std::make_shared<std::vector<char>>(GetEntry(pakFile, entryIndex).OriginalSize);
+    ExtractIndexedEntry(pakFile, entryIndex, buffer->data());
+
+    return buffer;
+}
+
+
+std::vector<std::vector<char>> Unpacker::ExtractMany(PakTypes::PakFile &pakFile, std::span<const std::string> filePaths) {
+    std::vector<size_t> entryIndices;
+    entryIndices.reserve(filePaths.size());
+
+    for (const auto &filePath: filePaths)
+        entryIndices.push_back(FindEntryIndex(pakFile, filePath));
+
+    return ExtractMany(pakFile, std::span<const size_t>(entryIndices));
+}
+
+std::vector<std::vector<char>> Unpacker::ExtractMany(PakTypes::PakFile &pakFile, std::span<const size_t> entryIndices) {
+    ScratchScope scratch;
+    std::vector<std::vector<char>> results(entryIndices.size());
+
+    std::vector<const PakTypes::PakFileTableEntry *> entries(entryIndices.size());
+    std::vector<size_t> order;
+    std::vector<size_t> uncached;
+    order.reserve(entryIndices.size());
+    for (size_t i = 0; i < entryIndices.size(); i++) {
+        const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndices[i]);
+        if (entry.PatchType == PakTypes::PatchType::PATCH_REMOVE)
+            throw std::runtime_error("File was removed by patch: " + std::string(entry.FilePath));
+
+        if (pakFile.Cache) {
+            if (EntryCache::Buffer cached = pakFile.Cache->Find(entryIndices[i])) {
+                results[i] = *cached;
+                continue;
+            }
+        }
+
+        if (EntryCache::Buffer prefetched = TakePrefetched(pakFile, entryIndices[i])) {
+            results[i] = *prefetched;
+            if (pakFile.Cache)
+                pakFile.Cache->Insert(entryIndices[i], prefetched);
+            continue;
         }
-#endif
 
-        std::vector<char> buffer;
-        if (entry.Compressed) {
-            buffer.resize(entry.OriginalSize);
+        if (pakFile.Cache)
+            uncached.push_back(i);
 
-            if (entry.CompressionType == PakTypes::CompressionType::ZLIB) {
-#ifdef USE_ZLIB
-                mz_ulong uncompressedSize = entry.OriginalSize;
-                int result = mz_uncompress(reinterpret_cast<unsigned char *>(buffer.data()), &uncompressedSize,
-                                           reinterpret_cast<const unsigned char *>(dataBuffer.data()),
-                                           entry.PackedSize);
-                if (result != MZ_OK)
-                    throw std::runtime_error("Failed to decompress file: " + filePath);
-#else
-                throw std::runtime_error("ZLIB compression is not supported");
-#endif
-            } else if (entry.CompressionType == PakTypes::CompressionType::LZ4) {
-#ifdef USE_LZ4
-                int decompressed_size = LZ4_decompress_safe(dataBuffer.data(), buffer.data(), dataBuffer.size(),
-                                                            buffer.size());
-                if (decompressed_size <= 0)
-                    throw std::runtime_error("Failed to decompress file: " + filePath);
-#else
-                throw std::runtime_error("LZ4 compression is not supported");
-#endif
-            } else if (entry.CompressionType == PakTypes::CompressionType::ZSTD) {
-#ifdef USE_ZSTD
-                size_t decompressed_size = ZSTD_decompress(buffer.data(), buffer.size(), dataBuffer.data(),
-                                                           dataBuffer.size());
-                if (ZSTD_isError(decompressed_size))
-                    throw std::runtime_error("Failed to decompress file: " + filePath);
-#else
-                throw std::runtime_error("ZSTD compression is not supported");
+        entries[i] = &entry;
+        results[i].resize(entry.OriginalSize);
+
+        // Chunks are scattered across the data region, so chunked entries are read on this thread
+        if (entry.Chunked) {
+            ReadChunks(pakFile, entry, 0, entry.OriginalSize, results[i].data());
+            VerifyChecksum(entry, results[i].data());
+            continue;
+        }
+
+        order.push_back(i);
+
+#ifdef USE_ENCRYPTION
+        if (entry.Encrypted)
+            PrepareEncryptionKey(pakFile.Header);
 #endif
-            } else {
-                throw std::invalid_argument("Unknown compression type");
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return entries[a]->Offset < entries[b]->Offset;
+    });
+
+    ThreadPool &pool = getThreadPool();
+    std::vector<std::future<void>> pending;
+
+    std::exception_ptr error;
+    try {
+        size_t runBegin = 0;
+        while (runBegin < order.size()) {
+            const PakTypes::PakFileTableEntry &first = *entries[order[runBegin]];
+            size_t readOffset = first.Offset;
+            size_t readEnd = first.Offset + first.PackedSize;
+
+            size_t runEnd = runBegin + 1;
+            while (runEnd < order.size()) {
+                const PakTypes::PakFileTableEntry &next = *entries[order[runEnd]];
+                size_t nextEnd = std::max(readEnd, next.Offset + next.PackedSize);
+
+                if (next.Offset > readEnd + MaxCoalesceGap || nextEnd - readOffset > MaxCoalescedRead)
+                    break;
+
+                readEnd = nextEnd;
+                runEnd++;
             }
-        } else {
-            buffer = std::move(dataBuffer);
+
+            auto runBuffer = std::make_shared<std::vector<char>>();
+            const char *runData = ReadData(pakFile, readOffset, readEnd - readOffset, *runBuffer);
+            if (runData == nullptr)
+                throw std::runtime_error("Failed to read file: " + std::string(first.FilePath));
+
+            for (size_t i = runBegin; i < runEnd; i++) {
+                size_t request = order[i];
+                const PakTypes::PakFileTableEntry &entry = *entries[request];
+                const char *packedData = runData + (entry.Offset - readOffset);
+
+                // An entry requested twice shares its packed bytes, so only unique entries decrypt in place
+                bool decryptInPlace = pakFile.Memory == nullptr &&
+                                      (i == runBegin || entries[order[i - 1]]->Offset != entry.Offset) &&
+                                      (i + 1 == runEnd || entries[order[i + 1]]->Offset != entry.Offset);
+
+                pending.push_back(pool.Submit([this, &entry, &results, runBuffer, packedData, request,
+                                               decryptInPlace]() {
+                    ScratchScope scratch;
+                    DecodeEntry(entry, packedData, results[request].data(), decryptInPlace);
+                    VerifyChecksum(entry, results[request].data());
+                }));
+            }
+
+            runBegin = runEnd;
         }
+    } catch (...) {
+        error = std::current_exception();
+    }
 
-        return buffer;
-    } else {
-        throw std::runtime_error("File not found in pak file: " + filePath);
+    for (auto &future: pending) {
+        try {
+            pool.Wait(future);
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
     }
+
+    if (error)
+        std::rethrow_exception(error);
+
+    for (size_t i: uncached)
+        pakFile.Cache->Insert(entryIndices[i], std::make_shared<const std::vector<char>>(results[i]));
+
+    return results;
 }
 
+std::vector<char> Unpacker::ReadRange(PakTypes::PakFile &pakFile, const std::string &filePath, size_t offset,
+                                      size_t length) {
+    ScratchScope scratch;
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, FindEntryIndex(pakFile, filePath));
+
+    if (offset > entry.OriginalSize)
+        throw std::out_of_range("Range is outside of file: " + filePath);
+
+    length = std::min(length, entry.OriginalSize - offset);
+    std::vector<char> buffer(length);
+
+    if (length == 0)
+        return buffer;
+
+    if (entry.Chunked) {
+        ReadChunks(pakFile, entry, offset, length, buffer.data());
+        return buffer;
+    }
+
+    if (!entry.Compressed && !entry.Encrypted) {
+        if (VerifiesMerkleTree(pakFile)) {
+            const char *data = ReadData(pakFile, entry.Offset + offset, length, context.packedBuffer);
+            if (data == nullptr)
+                throw std::runtime_error("Failed to read file: " + filePath);
+            std::memcpy(buffer.data(), data, length);
+        } else if (!ReadAt(pakFile, entry.Offset + offset, buffer.data(), length)) {
+            throw std::runtime_error("Failed to read file: " + filePath);
+        }
+        return buffer;
+    }
+
+    // Segmented encrypted entries only need the segments under the range decrypted
+    bool segmented = entry.Encrypted && entry.EncryptionBlockSize > 0;
+
+#ifdef USE_ENCRYPTION
+    if (entry.Encrypted)
+        PrepareEncryptionKey(pakFile.Header);
+#endif
+
+    if (!entry.Compressed && segmented) {
+        std::memcpy(buffer.data(), ReadPacked(pakFile, entry, offset, length, context.packedBuffer), length);
+        return buffer;
+    }
+
+    if ((entry.Encrypted && !segmented) || entry.BlockSize == 0 ||
+        entry.FilterType != PakTypes::FilterType::UNFILTERED) {
+        std::vector<char> whole(entry.OriginalSize);
+        ExtractEntry(pakFile, entry, whole.data());
+        std::memcpy(buffer.data(), whole.data() + offset, length);
+        return buffer;
+    }
+
+    ReadBlocks(pakFile, entry, offset, length, buffer.data());
+    return buffer;
+}
 
 void Unpacker::ExtractFileToDisk(PakTypes::PakFile &pakFile, const std::string &outputPath, const std::string &filePath) {
     std::vector<char> buffer = ExtractFileToMemory(pakFile, filePath);
@@ -91,17 +446,82 @@ void Unpacker::ExtractFileToDisk(PakTypes::PakFile &pakFile, const std::string &
     file.close();
 }
 
-PakTypes::PakFile Unpacker::ParsePakFile(const std::string &inputPath) {
+std::vector<char> Unpacker::ExtractPatchedFile(PakTypes::PakFile &basePak, PakTypes::PakFile &patchPak,
+                                               const std::string &filePath) {
+    VerifyPatch(basePak, patchPak);
+
+    if (!HasFile(patchPak, filePath))
+        return ExtractFileToMemory(basePak, filePath);
+
+    const PakTypes::PakFileTableEntry &entry = GetEntry(patchPak, FindEntryIndex(patchPak, filePath));
+    if (entry.PatchType != PakTypes::PatchType::PATCH_DELTA) {
+        ChunkBaseScope chunkBase(basePak);
+        return ExtractFileToMemory(patchPak, filePath);
+    }
+
+    std::vector<char> reference = ExtractFileToMemory(basePak, filePath);
+    std::vector<char> buffer(entry.OriginalSize);
+
+    ReferenceScope scope(reference);
+    ExtractEntry(patchPak, entry, buffer.data());
+
+    return buffer;
+}
+
+bool Unpacker::HasPatchedFile(PakTypes::PakFile &basePak, PakTypes::PakFile &patchPak, const std::string &filePath) {
+    if (HasFile(patchPak, filePath))
+        return GetEntry(patchPak, FindEntryIndex(patchPak, filePath)).PatchType != PakTypes::PatchType::PATCH_REMOVE;
+
+    return HasFile(basePak, filePath);
+}
+
+void Unpacker::VerifyPatch(const PakTypes::PakFile &basePak, const PakTypes::PakFile &patchPak) {
+    if (patchPak.Header.BaseBuildId == 0)
+        throw std::runtime_error("Pak file is not a patch");
+
+    if (patchPak.Header.BaseBuildId != basePak.Header.BuildId)
+        throw std::runtime_error("Patch was created against a different base pak");
+}
+
+std::vector<char> Unpacker::ReadPackedEntry(PakTypes::PakFile &pakFile, size_t entryIndex) {
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
+    std::vector<char> buffer(entry.PackedSize);
+
+    if (!ReadAt(pakFile, entry.Offset, buffer.data(), buffer.size()))
+        throw std::runtime_error("Failed to read file: " + std::string(entry.FilePath));
+
+    return buffer;
+}
+
+PakTypes::PakFile Unpacker::ParsePakFile(const std::string &inputPath, bool lazy) {
     PakTypes::PakFile file;
-    std::ifstream pakFile(inputPath, std::ios::binary);
+    std::ifstream pakFile(inputPath, std::ios::binary | std::ios::ate);
 
     if (!pakFile)
         throw std::runtime_error("Failed to open pak file: " + inputPath);
 
+    auto fileSize = static_cast<size_t>(pakFile.tellg());
+    pakFile.seekg(0);
+
     file.File = std::move(pakFile);
+    ParsePakTable(file, fileSize, inputPath, lazy);
+
+    return file;
+}
+
+PakTypes::PakFile Unpacker::ParsePakMemory(const void *data, size_t size, bool lazy) {
+    PakTypes::PakFile file;
+
+    file.Memory = static_cast<const char *>(data);
+    file.MemorySize = size;
+    ParsePakTable(file, size, "<memory>", lazy);
 
+    return file;
+}
+
+void Unpacker::ParsePakTable(PakTypes::PakFile &file, size_t fileSize, const std::string &inputPath, bool lazy) {
     PakTypes::PakHeader header;
-    if (!file.File.read(reinterpret_cast<char*>(&header), sizeof(PakTypes::PakHeader)))
+    if (!ReadAt(file, 0, &header, sizeof(PakTypes::PakHeader)))
         throw std::runtime_error("Failed to read header from pak file: " + inputPath);
 
     if (std::string(header.ID) != "PAK")
@@ -110,48 +530,1166 @@ PakTypes::PakFile Unpacker::ParsePakFile(const std::string &inputPath) {
     if (header.Version != PakTypes::PAK_FILE_VERSION)
         throw std::runtime_error("Unsupported PAK file version: " + inputPath);
 
-    std::vector<PakTypes::PakFileTableEntry> entries(header.NumEntries);
-    if (!file.File.read(reinterpret_cast<char*>(entries.data()), sizeof(PakTypes::PakFileTableEntry) * header.NumEntries))
-        throw std::runtime_error("Failed to read file entries from pak file: " + inputPath);
+    if (header.NumEntries > fileSize / (sizeof(PakTypes::PakFileTableEntry) + sizeof(PakTypes::PakLookupEntry)) ||
+        PakTypes::GetDataOffset(header.NumEntries) > fileSize)
+        throw std::runtime_error("Invalid file table in pak file: " + inputPath);
 
     file.Header = header;
-    file.FileEntries.reserve(entries.size() + header.NumEntries);
-    file.FileEntries.insert(file.FileEntries.end(), entries.begin(), entries.end());
+    file.Lazy = lazy;
 
-    return file;
+    if (header.NumChunks > 0) {
+        if (header.NumChunks > fileSize / sizeof(PakTypes::PakChunkEntry) || header.ChunkTableOffset > fileSize ||
+            header.NumChunks * sizeof(PakTypes::PakChunkEntry) > fileSize - header.ChunkTableOffset)
+            throw std::runtime_error("Invalid chunk table in pak file: " + inputPath);
+
+        file.Chunks.resize(header.NumChunks);
+        if (!ReadAt(file, header.ChunkTableOffset, file.Chunks.data(),
+                    sizeof(PakTypes::PakChunkEntry) * header.NumChunks))
+            throw std::runtime_error("Failed to read chunk table from pak file: " + inputPath);
+    }
+
+    if (header.MerkleTreeOffset > 0) {
+        size_t dataStart = PakTypes::GetDataOffset(header.NumEntries);
+        size_t dataEnd = PakTypes::GetDataEnd(header, fileSize);
+        if (header.MerkleBlockSize == 0 || dataEnd < dataStart || header.MerkleTreeOffset < dataEnd ||
+            header.MerkleTreeOffset > fileSize)
+            throw std::runtime_error("Invalid Merkle tree in pak file: " + inputPath);
+
+        file.MerkleLevels = MerkleTree::GetLevelOffsets(dataEnd - dataStart, header.MerkleBlockSize);
+        if (file.MerkleLevels.back() == 0 ||
+            file.MerkleLevels.back() > (fileSize - header.MerkleTreeOffset) / MerkleTree::HashSize)
+            throw std::runtime_error("Invalid Merkle tree in pak file: " + inputPath);
+    }
+
+    if (!lazy) {
+        file.FileEntries.resize(header.NumEntries);
+        if (!ReadAt(file, PakTypes::GetEntryTableOffset(), file.FileEntries.data(),
+                    sizeof(PakTypes::PakFileTableEntry) * header.NumEntries))
+            throw std::runtime_error("Failed to read file entries from pak file: " + inputPath);
+
+        file.Lookup.resize(header.NumEntries);
+        if (!ReadAt(file, PakTypes::GetLookupTableOffset(header.NumEntries), file.Lookup.data(),
+                    sizeof(PakTypes::PakLookupEntry) * header.NumEntries))
+            throw std::runtime_error("Failed to read lookup table from pak file: " + inputPath);
+    }
+
+    if (!file.MerkleLevels.empty())
+        VerifyTables(file, header, inputPath);
 }
 
-#ifdef USE_ENCRYPTION
-void Unpacker::GenerateEncryptionKey() {
-    sodium_init();
+void Unpacker::VerifyTables(PakTypes::PakFile &file, const PakTypes::PakHeader &header, const std::string &inputPath) {
+    size_t entriesSize = header.NumEntries * sizeof(PakTypes::PakFileTableEntry);
+    size_t lookupSize = header.NumEntries * sizeof(PakTypes::PakLookupEntry);
+    const char *entries = reinterpret_cast<const char *>(file.FileEntries.data());
+    const char *lookup = reinterpret_cast<const char *>(file.Lookup.data());
+
+    // Lazy paks page their tables in later, so a file backed one reads them through once here to hash them
+    std::vector<char> tables;
+    if (file.Lazy) {
+        entries = PeekAt(file, PakTypes::GetEntryTableOffset(), entriesSize + lookupSize);
+        if (entries == nullptr) {
+            tables.resize(entriesSize + lookupSize);
+            if (!ReadAt(file, PakTypes::GetEntryTableOffset(), tables.data(), tables.size()))
+                throw std::runtime_error("Failed to read file entries from pak file: " + inputPath);
+            entries = tables.data();
+        }
+        lookup = entries + entriesSize;
+    }
+
+    MerkleTree::Hash dataRoot;
+    if (!ReadAt(file, header.MerkleTreeOffset + (file.MerkleLevels.back() - 1) * MerkleTree::HashSize,
+                dataRoot.data(), MerkleTree::HashSize))
+        throw std::runtime_error("Failed to read Merkle tree from pak file: " + inputPath);
+
+    MerkleTree::Hash tableHash = PakTypes::HashTables(
+            header, {entries, entriesSize}, {lookup, lookupSize},
+            {reinterpret_cast<const char *>(file.Chunks.data()), file.Chunks.size() * sizeof(PakTypes::PakChunkEntry)});
+    if (std::memcmp(MerkleTree::HashParent(dataRoot, &tableHash).data(), header.MerkleRoot, MerkleTree::HashSize) != 0)
+        throw std::runtime_error("Pak header or tables do not match the Merkle root: " + inputPath);
+
+    file.MerkleNodes.emplace(file.MerkleLevels.back() - 1, dataRoot);
+}
+
+bool Unpacker::ReadAt(PakTypes::PakFile &pakFile, size_t offset, void *destination, size_t size) {
+    StageTimer timer(&PakTypes::PakReadTimings::IoSeconds);
+
+    if (pakFile.Memory != nullptr) {
+        if (offset > pakFile.MemorySize || size > pakFile.MemorySize - offset)
+            return false;
+        std::memcpy(destination, pakFile.Memory + offset, size);
+        return true;
+    }
+
+    pakFile.File.clear();
+    pakFile.File.seekg(static_cast<std::streamoff>(offset));
+    return static_cast<bool>(pakFile.File.read(static_cast<char *>(destination), static_cast<std::streamsize>(size)));
+}
+
+const char *Unpacker::PeekAt(const PakTypes::PakFile &pakFile, size_t offset, size_t size) {
+    if (pakFile.Memory == nullptr)
+        return nullptr;
+
+    if (offset > pakFile.MemorySize || size > pakFile.MemorySize - offset)
+        throw std::runtime_error("Read outside of pak data");
 
-    if (crypto_pwhash(key, sizeof key, password.c_str(), password.size(), salt,
-                      encryptionOpsLimit, encryptionMemLimit,
-                      crypto_pwhash_ALG_DEFAULT) != 0) {
-        throw std::exception("Key derivation failed");
+    return pakFile.Memory + offset;
+}
+
+size_t Unpacker::GetPakSize(PakTypes::PakFile &pakFile) {
+    if (pakFile.Memory != nullptr)
+        return pakFile.MemorySize;
+
+    pakFile.File.clear();
+    pakFile.File.seekg(0, std::ios::end);
+    return static_cast<size_t>(pakFile.File.tellg());
+}
+
+const char *Unpacker::ReadData(PakTypes::PakFile &pakFile, size_t offset, size_t size,
+                               std::vector<char> &scratch) const {
+    size_t begin = offset;
+    size_t end = offset + size;
+
+    bool verify = VerifiesMerkleTree(pakFile) && size > 0;
+    if (verify) {
+        // Hashes cover whole blocks, so the read is widened to the blocks around the range
+        size_t dataStart = PakTypes::GetDataOffset(pakFile.Header.NumEntries);
+        size_t dataEnd = PakTypes::GetDataEnd(pakFile.Header, pakFile.Header.MerkleTreeOffset);
+        size_t blockSize = pakFile.Header.MerkleBlockSize;
+
+        if (offset < dataStart || offset > dataEnd || size > dataEnd - offset)
+            throw std::runtime_error("Read outside of pak data");
+
+        begin = dataStart + (offset - dataStart) / blockSize * blockSize;
+        end = std::min(dataEnd, dataStart + (end - dataStart + blockSize - 1) / blockSize * blockSize);
     }
+
+    const char *data = PeekAt(pakFile, begin, end - begin);
+    if (data == nullptr) {
+        char *buffer = ReserveScratch(scratch, end - begin);
+        if (!ReadAt(pakFile, begin, buffer, end - begin))
+            return nullptr;
+        data = buffer;
+    }
+
+    if (verify)
+        VerifyMerkleBlocks(pakFile, begin, data, end - begin);
+
+    return data + (offset - begin);
 }
 
-void Unpacker::Decrypt(std::vector<char> &dataBuffer) const {
+const char *Unpacker::ReadPacked(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, size_t offset,
+                                 size_t size, std::vector<char> &scratch) const {
+    if (!entry.Encrypted) {
+        if (offset > entry.PackedSize || size > entry.PackedSize - offset)
+            throw std::runtime_error("Read outside of file: " + std::string(entry.FilePath));
+
+        const char *data = ReadData(pakFile, entry.Offset + offset, size, scratch);
+        if (data == nullptr)
+            throw std::runtime_error("Failed to read file: " + std::string(entry.FilePath));
+        return data;
+    }
+
+#ifdef USE_ENCRYPTION
+    if (entry.EncryptionBlockSize == 0 || !PakTypes::IsValidEncryptedSize(entry))
+        throw std::runtime_error("Invalid encrypted file: " + std::string(entry.FilePath));
+
+    size_t dataSize = PakTypes::GetDecryptedSize(entry);
+    if (offset > dataSize || size > dataSize - offset)
+        throw std::runtime_error("Read outside of file: " + std::string(entry.FilePath));
+
+    if (size == 0)
+        return ReserveScratch(scratch, 0);
+
+    size_t segmentSize = entry.EncryptionBlockSize;
+    size_t firstSegment = offset / segmentSize;
+    size_t segmentCount = (offset + size - 1) / segmentSize - firstSegment + 1;
+    size_t segmentStart = firstSegment * segmentSize;
+    size_t segmentEnd = std::min(dataSize, (firstSegment + segmentCount) * segmentSize);
+    size_t dataOffset = entry.Offset + crypto_secretbox_xchacha20poly1305_NONCEBYTES;
+
     unsigned char nonce[crypto_secretbox_xchacha20poly1305_NONCEBYTES];
-    std::memcpy(nonce, dataBuffer.data(), sizeof nonce);
+    const char *header = ReadData(pakFile, entry.Offset, sizeof nonce, context.authBuffer);
+    if (header == nullptr)
+        throw std::runtime_error("Failed to read file: " + std::string(entry.FilePath));
+    std::memcpy(nonce, header, sizeof nonce);
+
+    const char *macs = ReadData(pakFile, dataOffset + dataSize + firstSegment * crypto_secretbox_xchacha20poly1305_MACBYTES,
+                                segmentCount * crypto_secretbox_xchacha20poly1305_MACBYTES, context.authBuffer);
+    const char *ciphertext = ReadData(pakFile, dataOffset + segmentStart, segmentEnd - segmentStart, scratch);
+    if (macs == nullptr || ciphertext == nullptr)
+        throw std::runtime_error("Failed to read file: " + std::string(entry.FilePath));
+
+    // Data read from a file lands in scratch and is decrypted where it is
+    char *plaintext = pakFile.Memory == nullptr ? const_cast<char *>(ciphertext)
+                                                : ReserveScratch(scratch, segmentEnd - segmentStart);
+    DecryptSegments(entry, nonce, ciphertext, macs, firstSegment, segmentCount, plaintext);
+
+    return plaintext + (offset - segmentStart);
+#else
+    throw std::runtime_error("Encryption is not supported");
+#endif
+}
+
+void Unpacker::VerifyMerkleBlocks(PakTypes::PakFile &pakFile, size_t offset, const char *data, size_t size) {
+    StageTimer timer(&PakTypes::PakReadTimings::VerifySeconds);
+    size_t blockSize = pakFile.Header.MerkleBlockSize;
+    size_t firstLeaf = (offset - PakTypes::GetDataOffset(pakFile.Header.NumEntries)) / blockSize;
+
+    for (size_t position = 0; position < size; position += blockSize) {
+        VerifyMerklePath(pakFile, firstLeaf + position / blockSize,
+                         MerkleTree::HashLeaf(data + position, std::min(blockSize, size - position)));
+    }
+}
+
+void Unpacker::VerifyMerklePath(PakTypes::PakFile &pakFile, size_t leafIndex, MerkleTree::Hash hash) {
+    const std::vector<uint64_t> &levels = pakFile.MerkleLevels;
+    std::vector<std::pair<uint64_t, MerkleTree::Hash>> path;
+    size_t index = leafIndex;
+
+    // Climb until a node that is already trusted, which is at worst the root from the header
+    for (size_t level = 0; level + 1 < levels.size(); level++) {
+        uint64_t node = levels[level] + index;
 
-    size_t message_len = dataBuffer.size() - sizeof nonce - crypto_secretbox_xchacha20poly1305_MACBYTES;
-    auto *decrypted = new unsigned char[message_len];
+        auto verified = pakFile.MerkleNodes.find(node);
+        if (verified != pakFile.MerkleNodes.end()) {
+            if (verified->second != hash)
+                break;
 
-    if (crypto_secretbox_xchacha20poly1305_open_easy(decrypted,
-                                                     reinterpret_cast<const unsigned char *>(dataBuffer.data()) +
-                                                     sizeof nonce,
-                                                     dataBuffer.size() - sizeof nonce,
-                                                     nonce,
-                                                     key) != 0) {
-        throw std::exception("Decryption failed");
+            pakFile.MerkleNodes.insert(path.begin(), path.end());
+            return;
+        }
+
+        path.emplace_back(node, hash);
+
+        size_t sibling = index ^ 1;
+        bool hasSibling = sibling < levels[level + 1] - levels[level];
+        MerkleTree::Hash siblingHash{};
+
+        if (hasSibling) {
+            auto cached = pakFile.MerkleNodes.find(levels[level] + sibling);
+            if (cached != pakFile.MerkleNodes.end()) {
+                siblingHash = cached->second;
+            } else {
+                if (!ReadAt(pakFile, pakFile.Header.MerkleTreeOffset + (levels[level] + sibling) * MerkleTree::HashSize,
+                            siblingHash.data(), MerkleTree::HashSize))
+                    throw std::runtime_error("Failed to read Merkle tree from pak file");
+                path.emplace_back(levels[level] + sibling, siblingHash);
+            }
+        }
+
+        hash = index % 2 == 0 ? MerkleTree::HashParent(hash, hasSibling ? &siblingHash : nullptr)
+                              : MerkleTree::HashParent(siblingHash, &hash);
+        index /= 2;
     }
 
-    dataBuffer.clear();
-    dataBuffer.resize(message_len);
-    std::memcpy(dataBuffer.data(), decrypted, message_len);
+    throw std::runtime_error("Merkle tree verification failed for data block " + std::to_string(leafIndex));
+}
+
+std::future<PakTypes::PakFile> Unpacker::OpenAsync(const std::string &inputPath, std::vector<std::string> prefetch,
+                                                  bool lazy) {
+    return std::async(std::launch::async, [this, inputPath, prefetch = std::move(prefetch), lazy]() {
+        return PrepareOpenedPak(ParsePakFile(inputPath, lazy), prefetch);
+    });
+}
+
+std::future<PakTypes::PakFile> Unpacker::OpenAsync(const void *data, size_t size, std::vector<std::string> prefetch,
+                                                  bool lazy) {
+    return std::async(std::launch::async, [this, data, size, prefetch = std::move(prefetch), lazy]() {
+        return PrepareOpenedPak(ParsePakMemory(data, size, lazy), prefetch);
+    });
+}
+
+PakTypes::PakFile Unpacker::PrepareOpenedPak(PakTypes::PakFile pakFile, const std::vector<std::string> &prefetch) {
+    std::vector<size_t> entryIndices;
+    entryIndices.reserve(prefetch.size());
+    for (const auto &filePath: prefetch)
+        entryIndices.push_back(FindEntryIndex(pakFile, filePath));
+
+#ifdef USE_ENCRYPTION
+    bool hasEncryptedItem = std::any_of(entryIndices.begin(), entryIndices.end(), [&pakFile](size_t entryIndex) {
+        return GetEntry(pakFile, entryIndex).Encrypted;
+    });
 
-    delete[] decrypted;
+    if (!pakFile.Lazy) {
+        hasEncryptedItem = hasEncryptedItem || std::any_of(pakFile.FileEntries.begin(), pakFile.FileEntries.end(),
+                                                           [](const PakTypes::PakFileTableEntry &item) {
+                                                               return item.Encrypted;
+                                                           });
+    }
+
+    if (hasEncryptedItem)
+        PrepareEncryptionKey(pakFile.Header);
+#endif
+
+    if (entryIndices.empty())
+        return pakFile;
+
+    std::vector<std::vector<char>> buffers = ExtractMany(pakFile, std::span<const size_t>(entryIndices));
+
+    for (size_t i = 0; i < buffers.size(); i++)
+        pakFile.Prefetched[entryIndices[i]] = std::make_shared<const std::vector<char>>(std::move(buffers[i]));
+
+    return pakFile;
+}
+
+size_t Unpacker::GetEntryCount(const PakTypes::PakFile &pakFile) {
+    return pakFile.Header.NumEntries;
+}
+
+const PakTypes::PakFileTableEntry &Unpacker::GetEntry(PakTypes::PakFile &pakFile, size_t entryIndex) {
+    StageTimer timer(&PakTypes::PakReadTimings::LookupSeconds);
+
+    if (entryIndex >= pakFile.Header.NumEntries)
+        throw std::out_of_range("Invalid entry index: " + std::to_string(entryIndex));
+
+    if (!pakFile.Lazy)
+        return pakFile.FileEntries[entryIndex];
+
+    size_t pageIndex = entryIndex / EntryPageSize;
+    auto page = pakFile.EntryPages.find(pageIndex);
+
+    if (page == pakFile.EntryPages.end()) {
+        size_t first = pageIndex * EntryPageSize;
+        std::vector<PakTypes::PakFileTableEntry> entries(std::min(EntryPageSize, pakFile.Header.NumEntries - first));
+
+        if (!ReadAt(pakFile, PakTypes::GetEntryTableOffset() + first * sizeof(PakTypes::PakFileTableEntry),
+                    entries.data(), entries.size() * sizeof(PakTypes::PakFileTableEntry)))
+            throw std::runtime_error("Failed to read file entries from pak file");
+
+        page = pakFile.EntryPages.emplace(pageIndex, std::move(entries)).first;
+    }
+
+    return page->second[entryIndex % EntryPageSize];
+}
+
+void Unpacker::ForEachEntry(PakTypes::PakFile &pakFile,
+                            const std::function<void(size_t, const PakTypes::PakFileTableEntry &)> &callback) {
+    if (!pakFile.Lazy) {
+        for (size_t i = 0; i < pakFile.FileEntries.size(); i++)
+            callback(i, pakFile.FileEntries[i]);
+        return;
+    }
+
+    PakTypes::PakFileTableEntry entries[EntryPageSize];
+
+    for (size_t first = 0; first < pakFile.Header.NumEntries; first += EntryPageSize) {
+        size_t count = std::min(EntryPageSize, pakFile.Header.NumEntries - first);
+
+        if (!ReadAt(pakFile, PakTypes::GetEntryTableOffset() + first * sizeof(PakTypes::PakFileTableEntry), entries,
+                    count * sizeof(PakTypes::PakFileTableEntry)))
+            throw std::runtime_error("Failed to read file entries from pak file");
+
+        for (size_t i = 0; i < count; i++)
+            callback(first + i, entries[i]);
+    }
+}
+
+PakTypes::PakEntryInfo Unpacker::GetEntryInfo(PakTypes::PakFile &pakFile, const std::string &filePath) {
+    size_t entryIndex = FindEntryIndex(pakFile, filePath);
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
+
+    return {
+            .Index = entryIndex,
+            .OriginalSize = entry.OriginalSize,
+            .PackedSize = entry.PackedSize,
+            .Compressed = entry.Compressed,
+            .Encrypted = entry.Encrypted,
+            .Chunked = entry.Chunked,
+            .CompressionType = entry.CompressionType,
+            .CookType = entry.CookType,
+            .FilterType = entry.FilterType,
+            .ElementSize = entry.ElementSize,
+            .Checksum = entry.Checksum
+    };
+}
+
+void Unpacker::EnableCache(PakTypes::PakFile &pakFile, size_t budgetBytes) {
+    if (pakFile.Cache)
+        pakFile.Cache->setBudget(budgetBytes);
+    else
+        pakFile.Cache = std::make_shared<EntryCache>(budgetBytes);
+}
+
+void Unpacker::DisableCache(PakTypes::PakFile &pakFile) {
+    pakFile.Cache.reset();
+}
+
+EntryCache::Stats Unpacker::GetCacheStats(const PakTypes::PakFile &pakFile) {
+    return pakFile.Cache ? pakFile.Cache->GetStats() : EntryCache::Stats{};
+}
+
+bool Unpacker::getCollectReadTimings() {
+    return collectReadTimings.load(std::memory_order_relaxed);
+}
+
+void Unpacker::setCollectReadTimings(bool enabled) {
+    collectReadTimings.store(enabled, std::memory_order_relaxed);
+}
+
+PakTypes::PakReadTimings Unpacker::GetReadTimings() {
+    return readTimings;
+}
+
+void Unpacker::ResetReadTimings() {
+    readTimings = {};
+}
+
+PakTypes::PakVerifyResult Unpacker::VerifyPakFile(PakTypes::PakFile &pakFile) {
+    ScratchScope scratch;
+    PakTypes::PakVerifyResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<PakTypes::PakFileTableEntry> entries = VerifyTable(pakFile, result.Errors);
+    bool patch = pakFile.Header.BaseBuildId != 0;
+    std::erase_if(entries, [&result, patch](const PakTypes::PakFileTableEntry &entry) {
+        if (entry.PatchType == PakTypes::PatchType::PATCH_REPLACE && !(patch && entry.Chunked))
+            return false;
+        result.EntriesSkipped++;
+        return true;
+    });
+
+    std::sort(entries.begin(), entries.end(), [](const PakTypes::PakFileTableEntry &a,
+                                                 const PakTypes::PakFileTableEntry &b) {
+        return a.Offset < b.Offset;
+    });
+
+#ifdef USE_ENCRYPTION
+    if (std::any_of(entries.begin(), entries.end(), [](const auto &entry) { return entry.Encrypted; })) {
+        try {
+            PrepareEncryptionKey(pakFile.Header);
+        } catch (const std::exception &e) {
+            result.Errors.emplace_back(e.what());
+            std::erase_if(entries, [](const auto &entry) { return entry.Encrypted; });
+        }
+    }
+#endif
+
+    ThreadPool &pool = getThreadPool();
+    std::vector<std::string> entryErrors(entries.size());
+    std::deque<std::pair<std::future<void>, size_t>> pending;
+    size_t inFlight = 0;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const PakTypes::PakFileTableEntry &entry = entries[i];
+        result.EntriesChecked++;
+        result.OriginalBytes += entry.OriginalSize;
+        result.PackedBytes += entry.PackedSize;
+
+        try {
+            if (entry.Chunked) {
+                char *decoded = ReserveScratch(context.verifyBuffer, entry.OriginalSize);
+                ReadChunks(pakFile, entry, 0, entry.OriginalSize, decoded);
+                if (Checksum::Crc32c(decoded, entry.OriginalSize) != entry.Checksum)
+                    throw std::runtime_error("Checksum mismatch");
+                continue;
+            }
+
+            auto packedBuffer = std::make_shared<std::vector<char>>();
+            const char *packedData = ReadData(pakFile, entry.Offset, entry.PackedSize, *packedBuffer);
+            if (packedData == nullptr)
+                throw std::runtime_error("Failed to read file");
+
+            while (!pending.empty() && inFlight > MaxVerifyInFlight) {
+                pool.Wait(pending.front().first);
+                inFlight -= pending.front().second;
+                pending.pop_front();
+            }
+
+            inFlight += entry.PackedSize;
+            bool decryptInPlace = pakFile.Memory == nullptr;
+            pending.emplace_back(pool.Submit([this, &entry, &error = entryErrors[i], packedBuffer, packedData,
+                                              decryptInPlace]() {
+                ScratchScope scratch;
+                try {
+                    const char *decoded = packedData;
+                    if (entry.Compressed || entry.Encrypted) {
+                        char *destination = ReserveScratch(context.verifyBuffer, entry.OriginalSize);
+                        DecodeEntry(entry, packedData, destination, decryptInPlace);
+                        decoded = destination;
+                    }
+
+                    if (Checksum::Crc32c(decoded, entry.OriginalSize) != entry.Checksum)
+                        throw std::runtime_error("Checksum mismatch");
+                } catch (const std::exception &e) {
+                    error = e.what();
+                }
+            }), entry.PackedSize);
+        } catch (const std::exception &e) {
+            entryErrors[i] = e.what();
+        }
+    }
+
+    for (auto &task: pending)
+        pool.Wait(task.first);
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!entryErrors[i].empty())
+            result.Errors.push_back(std::string(entries[i].FilePath) + ": " + entryErrors[i]);
+    }
+
+    result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::vector<PakTypes::PakFileTableEntry> Unpacker::VerifyTable(PakTypes::PakFile &pakFile,
+                                                               std::vector<std::string> &errors) {
+    const PakTypes::PakHeader &header = pakFile.Header;
+    size_t dataStart = PakTypes::GetDataOffset(header.NumEntries);
+    size_t dataEnd = PakTypes::GetDataEnd(header, GetPakSize(pakFile));
+
+    if (dataEnd < dataStart) {
+        errors.emplace_back("Invalid data region in pak file");
+        return {};
+    }
+
+    struct Extent {
+        size_t Begin;
+        size_t End;
+        std::string Name;
+    };
+
+    std::vector<Extent> extents;
+    std::vector<PakTypes::PakFileTableEntry> entries;
+    entries.reserve(header.NumEntries);
+
+    ForEachEntry(pakFile, [&](size_t index, const PakTypes::PakFileTableEntry &entry) {
+        if (std::memchr(entry.FilePath, 0, sizeof(entry.FilePath)) == nullptr) {
+            errors.push_back("Entry " + std::to_string(index) + ": Unterminated file path");
+            return;
+        }
+
+        std::string name = entry.FilePath;
+        auto fail = [&](const char *message) {
+            errors.push_back(name + ": " + message);
+        };
+
+        if (entry.CompressionType >= PakTypes::CompressionCount || entry.FilterType >= PakTypes::FilterCount ||
+            entry.PatchType > PakTypes::PatchType::PATCH_REMOVE ||
+            (entry.CookType > PakTypes::CookType::TEXT_NORMALIZE && entry.CookType < PakTypes::CookType::CUSTOM))
+            return fail("Unknown entry type");
+
+        if (entry.FilterType != PakTypes::FilterType::UNFILTERED && !Filters::IsValidElementSize(entry.ElementSize))
+            return fail("Invalid filter element size");
+
+        if (entry.Offset < dataStart || entry.Offset > dataEnd || entry.PackedSize > dataEnd - entry.Offset)
+            return fail("Entry data is outside of the data region");
+
+        if (entry.Chunked && entry.PackedSize % sizeof(uint64_t) != 0)
+            return fail("Invalid chunk list");
+
+        if (!entry.Chunked && !entry.Compressed && !entry.Encrypted && entry.PackedSize != entry.OriginalSize)
+            return fail("Packed size does not match original size");
+
+#ifdef USE_ENCRYPTION
+        if (entry.Encrypted && (!PakTypes::IsValidEncryptedSize(entry) ||
+                                (!entry.Compressed && PakTypes::GetDecryptedSize(entry) != entry.OriginalSize)))
+            return fail("Invalid encrypted size");
+#endif
+
+        if (entry.PackedSize > 0)
+            extents.push_back({entry.Offset, entry.Offset + entry.PackedSize, name});
+
+        entries.push_back(entry);
+    });
+
+    for (size_t i = 0; i < pakFile.Chunks.size(); i++) {
+        const PakTypes::PakChunkEntry &chunk = pakFile.Chunks[i];
+        std::string name = "Chunk " + std::to_string(i);
+
+        if (chunk.Offset < dataStart || chunk.Offset > dataEnd || chunk.PackedSize > dataEnd - chunk.Offset)
+            errors.push_back(name + ": Chunk data is outside of the data region");
+        else if (chunk.PackedSize > 0)
+            extents.push_back({chunk.Offset, chunk.Offset + chunk.PackedSize, name});
+    }
+
+    std::sort(extents.begin(), extents.end(), [](const Extent &a, const Extent &b) {
+        return a.Begin < b.Begin;
+    });
+
+    for (size_t i = 1; i < extents.size(); i++) {
+        if (extents[i].Begin < extents[i - 1].End)
+            errors.push_back(extents[i].Name + ": Data overlaps " + extents[i - 1].Name);
+    }
+
+    std::vector<bool> indexed(header.NumEntries);
+    try {
+        uint64_t previousHash = 0;
+        for (size_t i = 0; i < header.NumEntries; i++) {
+            const PakTypes::PakLookupEntry &lookup = GetLookupEntry(pakFile, i);
+            const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, lookup.EntryIndex);
+
+            if (lookup.PathHash < previousHash)
+                errors.emplace_back("Lookup table is not sorted");
+            else if (indexed[lookup.EntryIndex])
+                errors.push_back("Entry " + std::to_string(lookup.EntryIndex) + " is in the lookup table twice");
+            else if (std::memchr(entry.FilePath, 0, sizeof(entry.FilePath)) != nullptr &&
+                     lookup.PathHash != PakTypes::HashPath(entry.FilePath))
+                errors.push_back(std::string(entry.FilePath) + ": Lookup hash does not match path");
+
+            indexed[lookup.EntryIndex] = true;
+            previousHash = lookup.PathHash;
+        }
+    } catch (const std::exception &e) {
+        errors.emplace_back(e.what());
+    }
+
+    return entries;
+}
+
+bool Unpacker::HasFile(PakTypes::PakFile &pakFile, const std::string &filePath) {
+    StageTimer timer(&PakTypes::PakReadTimings::LookupSeconds);
+    uint64_t pathHash = PakTypes::HashPath(filePath);
+
+    for (size_t i = FindLookupIndex(pakFile, pathHash); i < pakFile.Header.NumEntries; i++) {
+        const PakTypes::PakLookupEntry &lookup = GetLookupEntry(pakFile, i);
+        if (lookup.PathHash != pathHash)
+            break;
+
+        if (filePath == GetEntry(pakFile, lookup.EntryIndex).FilePath)
+            return true;
+    }
+
+    return false;
+}
+
+size_t Unpacker::FindEntryIndex(PakTypes::PakFile &pakFile, const std::string &filePath) {
+    StageTimer timer(&PakTypes::PakReadTimings::LookupSeconds);
+    uint64_t pathHash = PakTypes::HashPath(filePath);
+
+    for (size_t i = FindLookupIndex(pakFile, pathHash); i < pakFile.Header.NumEntries; i++) {
+        const PakTypes::PakLookupEntry &lookup = GetLookupEntry(pakFile, i);
+        if (lookup.PathHash != pathHash)
+            break;
+
+        if (filePath == GetEntry(pakFile, lookup.EntryIndex).FilePath)
+            return lookup.EntryIndex;
+    }
+
+    throw std::runtime_error("File not found in pak file: " + filePath);
+}
+
+size_t Unpacker::FindEntryIndex(PakTypes::PakFile &pakFile, const PakTypes::ResourceId &resourceId) {
+    StageTimer timer(&PakTypes::PakReadTimings::LookupSeconds);
+
+    if (resourceId.BuildId != 0 && resourceId.BuildId == pakFile.Header.BuildId) {
+        if (resourceId.EntryIndex >= pakFile.Header.NumEntries ||
+            GetEntry(pakFile, resourceId.EntryIndex).Offset != resourceId.Offset)
+            throw std::runtime_error("Resource id does not match the pak file it was generated for");
+
+        return resourceId.EntryIndex;
+    }
+
+    // The packer rejects hash collisions, so the first matching hash is the entry.
+    size_t lookupIndex = FindLookupIndex(pakFile, resourceId.PathHash);
+    if (lookupIndex < pakFile.Header.NumEntries) {
+        const PakTypes::PakLookupEntry &lookup = GetLookupEntry(pakFile, lookupIndex);
+        if (lookup.PathHash == resourceId.PathHash)
+            return lookup.EntryIndex;
+    }
+
+    throw std::runtime_error("Resource not found in pak file: " + std::to_string(resourceId.PathHash));
+}
+
+void Unpacker::VerifyBuildId(const PakTypes::PakFile &pakFile, uint64_t buildId) {
+    if (pakFile.Header.BuildId != buildId)
+        throw std::runtime_error("Pak build id " + std::to_string(pakFile.Header.BuildId) +
+                                 " does not match the expected build " + std::to_string(buildId));
+}
+
+void Unpacker::VerifyMerkleRoot(const PakTypes::PakFile &pakFile, const MerkleTree::Hash &root) {
+    if (pakFile.MerkleLevels.empty())
+        throw std::runtime_error("Pak file has no Merkle tree");
+
+    if (std::memcmp(pakFile.Header.MerkleRoot, root.data(), MerkleTree::HashSize) != 0)
+        throw std::runtime_error("Pak Merkle root does not match the expected root");
+}
+
+size_t Unpacker::FindLookupIndex(PakTypes::PakFile &pakFile, uint64_t pathHash) {
+    size_t low = 0;
+    size_t high = pakFile.Header.NumEntries;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (GetLookupEntry(pakFile, middle).PathHash < pathHash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+const PakTypes::PakLookupEntry &Unpacker::GetLookupEntry(PakTypes::PakFile &pakFile, size_t lookupIndex) {
+    if (!pakFile.Lazy)
+        return pakFile.Lookup[lookupIndex];
+
+    size_t pageIndex = lookupIndex / LookupPageSize;
+    auto page = pakFile.LookupPages.find(pageIndex);
+
+    if (page == pakFile.LookupPages.end()) {
+        size_t first = pageIndex * LookupPageSize;
+        std::vector<PakTypes::PakLookupEntry> entries(std::min(LookupPageSize, pakFile.Header.NumEntries - first));
+
+        if (!ReadAt(pakFile, PakTypes::GetLookupTableOffset(pakFile.Header.NumEntries) + first * sizeof(PakTypes::PakLookupEntry),
+                    entries.data(), entries.size() * sizeof(PakTypes::PakLookupEntry)))
+            throw std::runtime_error("Failed to read lookup table from pak file");
+
+        page = pakFile.LookupPages.emplace(pageIndex, std::move(entries)).first;
+    }
+
+    const PakTypes::PakLookupEntry &lookup = page->second[lookupIndex % LookupPageSize];
+    if (lookup.EntryIndex >= pakFile.Header.NumEntries)
+        throw std::runtime_error("Invalid lookup table in pak file");
+
+    return lookup;
+}
+
+void Unpacker::ExtractIndexedEntry(PakTypes::PakFile &pakFile, size_t entryIndex, char *destination) {
+    if (pakFile.Cache) {
+        EntryCache::Buffer cached = ExtractCachedEntry(pakFile, entryIndex);
+        std::memcpy(destination, cached->data(), cached->size());
+        return;
+    }
+
+    if (EntryCache::Buffer prefetched = TakePrefetched(pakFile, entryIndex)) {
+        std::memcpy(destination, prefetched->data(), prefetched->size());
+        return;
+    }
+
+    ExtractEntry(pakFile, GetEntry(pakFile, entryIndex), destination);
+}
+
+EntryCache::Buffer Unpacker::ExtractCachedEntry(PakTypes::PakFile &pakFile, size_t entryIndex) {
+    if (EntryCache::Buffer cached = pakFile.Cache->Find(entryIndex))
+        return cached;
+
+    if (EntryCache::Buffer prefetched = TakePrefetched(pakFile, entryIndex)) {
+        pakFile.Cache->Insert(entryIndex, prefetched);
+        return prefetched;
+    }
+
+    const PakTypes::PakFileTableEntry &entry = GetEntry(pakFile, entryIndex);
+
+    auto buffer = std::make_shared<std::vector<char>>(entry.OriginalSize);
+    ExtractEntry(pakFile, entry, buffer->data());
+
+    EntryCache::Buffer shared = std::move(buffer);
+    pakFile.Cache->Insert(entryIndex, shared);
+
+    return shared;
+}
+
+EntryCache::Buffer Unpacker::TakePrefetched(PakTypes::PakFile &pakFile, size_t entryIndex) {
+    auto prefetched = pakFile.Prefetched.find(entryIndex);
+    if (prefetched == pakFile.Prefetched.end())
+        return nullptr;
+
+    EntryCache::Buffer buffer = std::move(prefetched->second);
+    pakFile.Prefetched.erase(prefetched);
+    return buffer;
+}
+
+void Unpacker::ExtractEntry(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, char *destination) {
+    ScratchScope scratch;
+
+    if (entry.PatchType == PakTypes::PatchType::PATCH_REMOVE)
+        throw std::runtime_error("File was removed by patch: " + std::string(entry.FilePath));
+
+    if (entry.Chunked) {
+        ReadChunks(pakFile, entry, 0, entry.OriginalSize, destination);
+        VerifyChecksum(entry, destination);
+        return;
+    }
+
+#ifdef USE_ENCRYPTION
+    if (entry.Encrypted) {
+        PrepareEncryptionKey(pakFile.Header);
+
+        if (entry.EncryptionBlockSize > 0 && entry.PackedSize > MaxCoalescedRead &&
+            (!entry.Compressed || entry.BlockSize > 0)) {
+            StreamEntry(pakFile, entry, destination);
+            VerifyChecksum(entry, destination);
+            return;
+        }
+    }
+#endif
+
+    if (!entry.Compressed && !entry.Encrypted && !VerifiesMerkleTree(pakFile)) {
+        if (!ReadAt(pakFile, entry.Offset, destination, entry.PackedSize))
+            throw std::runtime_error("Failed to read file: " + std::string(entry.FilePath));
+        VerifyChecksum(entry, destination);
+        return;
+    }
+
+    const char *packedData = ReadData(pakFile, entry.Offset, entry.PackedSize, context.packedBuffer);
+    if (packedData == nullptr)
+        throw std::runtime_error("Failed to read file: " + std::string(entry.FilePath));
+
+    // Data read from a file lands in this thread's scratch buffer, which can be decrypted in place
+    DecodeEntry(entry, packedData, destination, pakFile.Memory == nullptr);
+    VerifyChecksum(entry, destination);
+}
+
+void Unpacker::StreamEntry(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry,
+                           char *destination) const {
+    if (entry.Compressed) {
+        if (entry.FilterType == PakTypes::FilterType::UNFILTERED) {
+            ReadBlocks(pakFile, entry, 0, entry.OriginalSize, destination);
+            return;
+        }
+
+        char *filteredData = ReserveScratch(context.filterBuffer, entry.OriginalSize);
+        ReadBlocks(pakFile, entry, 0, entry.OriginalSize, filteredData);
+        StageTimer timer(&PakTypes::PakReadTimings::DecompressSeconds);
+        Filters::Undo(entry.FilterType, entry.ElementSize, filteredData, destination, entry.OriginalSize);
+        return;
+    }
+
+#ifdef USE_ENCRYPTION
+    if (PakTypes::GetDecryptedSize(entry) != entry.OriginalSize)
+        throw std::runtime_error("Invalid encrypted file: " + std::string(entry.FilePath));
+#endif
+
+    size_t pieceSize = std::max<size_t>(1, MaxCoalescedRead / entry.EncryptionBlockSize) * entry.EncryptionBlockSize;
+    for (size_t offset = 0; offset < entry.OriginalSize; offset += pieceSize) {
+        size_t length = std::min(pieceSize, entry.OriginalSize - offset);
+        std::memcpy(destination + offset, ReadPacked(pakFile, entry, offset, length, context.packedBuffer), length);
+    }
+}
+
+void Unpacker::ReadBlocks(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, size_t offset,
+                          size_t length, char *destination) const {
+    size_t firstBlock = offset / entry.BlockSize;
+    size_t lastBlock = (offset + length - 1) / entry.BlockSize;
+    size_t tableSize = PakTypes::GetBlockTableSize(entry.OriginalSize, entry.BlockSize);
+
+    std::vector<uint64_t> blockOffsets(lastBlock - firstBlock + 2);
+    std::memcpy(blockOffsets.data(), ReadPacked(pakFile, entry, firstBlock * sizeof(uint64_t),
+                                                blockOffsets.size() * sizeof(uint64_t), context.blockBuffer),
+                blockOffsets.size() * sizeof(uint64_t));
+
+    for (size_t i = 1; i < blockOffsets.size(); i++) {
+        if (blockOffsets[i - 1] > blockOffsets[i])
+            throw std::runtime_error("Invalid block table: " + std::string(entry.FilePath));
+    }
+
+    // Blocks are read in batches so a large range does not need its packed data in memory all at once
+    size_t block = firstBlock;
+    while (block <= lastBlock) {
+        size_t batchEnd = block + 1;
+        while (batchEnd <= lastBlock &&
+               blockOffsets[batchEnd + 1 - firstBlock] - blockOffsets[block - firstBlock] <= MaxCoalescedRead)
+            batchEnd++;
+
+        size_t packedStart = blockOffsets[block - firstBlock];
+        const char *packedData = ReadPacked(pakFile, entry, tableSize + packedStart,
+                                            blockOffsets[batchEnd - firstBlock] - packedStart, context.packedBuffer);
+
+        for (; block < batchEnd; block++) {
+            size_t blockStart = block * entry.BlockSize;
+            size_t blockLength = std::min(entry.BlockSize, entry.OriginalSize - blockStart);
+            size_t copyStart = std::max(offset, blockStart);
+            size_t copyEnd = std::min(offset + length, blockStart + blockLength);
+
+            const char *source = packedData + (blockOffsets[block - firstBlock] - packedStart);
+            size_t sourceSize = blockOffsets[block - firstBlock + 1] - blockOffsets[block - firstBlock];
+
+            if (copyStart == blockStart && copyEnd == blockStart + blockLength) {
+                DecompressBlock(entry, source, sourceSize, destination + (blockStart - offset), blockLength);
+            } else {
+                char *blockBuffer = ReserveScratch(context.blockBuffer, blockLength);
+                DecompressBlock(entry, source, sourceSize, blockBuffer, blockLength);
+                std::memcpy(destination + (copyStart - offset), blockBuffer + (copyStart - blockStart),
+                            copyEnd - copyStart);
+            }
+        }
+    }
+}
+
+void Unpacker::VerifyChecksum(const PakTypes::PakFileTableEntry &entry, const char *data) const {
+    if (!verifyChecksums)
+        return;
+
+    StageTimer timer(&PakTypes::PakReadTimings::VerifySeconds);
+    if (Checksum::Crc32c(data, entry.OriginalSize) != entry.Checksum)
+        throw std::runtime_error("Checksum mismatch: " + std::string(entry.FilePath));
+}
+
+void Unpacker::DecodeEntry(const PakTypes::PakFileTableEntry &entry, const char *packedData, char *destination,
+                           bool decryptInPlace) const {
+    if (entry.Chunked)
+        throw std::logic_error("Chunked entries must be read with ReadChunks: " + std::string(entry.FilePath));
+
+#ifndef USE_ENCRYPTION
+    if (entry.Encrypted)
+        throw std::runtime_error("Encryption is not supported");
+#endif
+
+    if (!entry.Compressed && !entry.Encrypted) {
+        std::memcpy(destination, packedData, entry.PackedSize);
+        return;
+    }
+
+    const char *source = packedData;
+    size_t sourceSize = entry.PackedSize;
+
+#ifdef USE_ENCRYPTION
+    if (entry.Encrypted) {
+        if (!PakTypes::IsValidEncryptedSize(entry))
+            throw std::runtime_error("Invalid encrypted file: " + std::string(entry.FilePath));
+
+        sourceSize = PakTypes::GetDecryptedSize(entry);
+
+        if (!entry.Compressed) {
+            if (sourceSize != entry.OriginalSize)
+                throw std::runtime_error("Invalid encrypted file: " + std::string(entry.FilePath));
+            DecryptEntry(entry, packedData, destination);
+            return;
+        }
+
+        size_t ciphertextOffset = entry.EncryptionBlockSize > 0 ? crypto_secretbox_xchacha20poly1305_NONCEBYTES
+                                                                : PakTypes::EncryptionOverhead;
+        char *decryptedData = decryptInPlace ? const_cast<char *>(packedData) + ciphertextOffset
+                                             : ReserveScratch(context.decryptedBuffer, sourceSize);
+        DecryptEntry(entry, packedData, decryptedData);
+        source = decryptedData;
+    }
+#endif
+
+    if (entry.FilterType != PakTypes::FilterType::UNFILTERED) {
+        char *filteredData = ReserveScratch(context.filterBuffer, entry.OriginalSize);
+        Decompress(entry, source, sourceSize, filteredData);
+        StageTimer timer(&PakTypes::PakReadTimings::DecompressSeconds);
+        Filters::Undo(entry.FilterType, entry.ElementSize, filteredData, destination, entry.OriginalSize);
+        return;
+    }
+
+    Decompress(entry, source, sourceSize, destination);
+}
+
+void Unpacker::ReadChunks(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, size_t offset,
+                          size_t length, char *destination) const {
+    std::vector<uint64_t> chunkIndices(entry.PackedSize / sizeof(uint64_t));
+    const char *chunkList = ReadData(pakFile, entry.Offset, chunkIndices.size() * sizeof(uint64_t),
+                                     context.packedBuffer);
+    if (chunkList == nullptr)
+        throw std::runtime_error("Failed to read chunk list: " + std::string(entry.FilePath));
+    std::memcpy(chunkIndices.data(), chunkList, chunkIndices.size() * sizeof(uint64_t));
+
+    PakTypes::PakFileTableEntry chunkEntry = entry;
+    size_t chunkStart = 0;
+
+    for (uint64_t chunkIndex: chunkIndices) {
+        if (chunkStart >= offset + length)
+            break;
+
+        PakTypes::PakFile *chunkPak = &pakFile;
+        if (chunkIndex & PakTypes::BaseChunkFlag) {
+            if (pakFile.Header.BaseBuildId == 0 || context.chunkBase == nullptr)
+                throw std::runtime_error("File uses chunks from the base pak, read it with ExtractPatchedFile: " +
+                                         std::string(entry.FilePath));
+            chunkPak = context.chunkBase;
+            chunkIndex &= ~PakTypes::BaseChunkFlag;
+        }
+
+        if (chunkIndex >= chunkPak->Chunks.size())
+            throw std::runtime_error("Invalid chunk list: " + std::string(entry.FilePath));
+
+        const PakTypes::PakChunkEntry &chunk = chunkPak->Chunks[chunkIndex];
+        size_t chunkEnd = chunkStart + chunk.OriginalSize;
+        if (chunkEnd <= offset) {
+            chunkStart = chunkEnd;
+            continue;
+        }
+
+        const char *packedData = ReadData(*chunkPak, chunk.Offset, chunk.PackedSize, context.packedBuffer);
+        if (packedData == nullptr)
+            throw std::runtime_error("Failed to read chunk: " + std::string(entry.FilePath));
+
+        size_t copyStart = std::max(offset, chunkStart);
+        size_t copyEnd = std::min(offset + length, chunkEnd);
+        bool whole = copyStart == chunkStart && copyEnd == chunkEnd;
+        char *chunkData = whole ? destination + (chunkStart - offset) : ReserveScratch(context.blockBuffer, chunk.OriginalSize);
+
+        if (chunk.Compressed) {
+            chunkEntry.CompressionType = chunk.CompressionType;
+            DecompressBlock(chunkEntry, packedData, chunk.PackedSize, chunkData, chunk.OriginalSize);
+        } else if (chunk.PackedSize == chunk.OriginalSize) {
+            std::memcpy(chunkData, packedData, chunk.OriginalSize);
+        } else {
+            throw std::runtime_error("Invalid chunk: " + std::string(entry.FilePath));
+        }
+
+        if (!whole)
+            std::memcpy(destination + (copyStart - offset), chunkData + (copyStart - chunkStart), copyEnd - copyStart);
+
+        chunkStart = chunkEnd;
+    }
+
+    if (chunkStart < std::min(offset + length, entry.OriginalSize))
+        throw std::runtime_error("Invalid chunk list: " + std::string(entry.FilePath));
+}
+
+void Unpacker::Decompress(const PakTypes::PakFileTableEntry &entry, const char *source, size_t sourceSize,
+                          char *destination) {
+    StageTimer timer(&PakTypes::PakReadTimings::DecompressSeconds);
+
+    if (entry.BlockSize == 0) {
+        DecompressBlock(entry, source, sourceSize, destination, entry.OriginalSize);
+        return;
+    }
+
+    size_t blockCount = PakTypes::GetBlockCount(entry.OriginalSize, entry.BlockSize);
+    size_t tableSize = PakTypes::GetBlockTableSize(entry.OriginalSize, entry.BlockSize);
+    if (sourceSize < tableSize)
+        throw std::runtime_error("Invalid block table: " + std::string(entry.FilePath));
+
+    const char *blockData = source + tableSize;
+    size_t blockDataSize = sourceSize - tableSize;
+
+    for (size_t i = 0; i < blockCount; i++) {
+        uint64_t blockStart, blockEnd;
+        std::memcpy(&blockStart, source + i * sizeof(uint64_t), sizeof(uint64_t));
+        std::memcpy(&blockEnd, source + (i + 1) * sizeof(uint64_t), sizeof(uint64_t));
+
+        if (blockStart > blockEnd || blockEnd > blockDataSize)
+            throw std::runtime_error("Invalid block table: " + std::string(entry.FilePath));
+
+        size_t outputStart = i * entry.BlockSize;
+        DecompressBlock(entry, blockData + blockStart, blockEnd - blockStart, destination + outputStart,
+                        std::min(entry.BlockSize, entry.OriginalSize - outputStart));
+    }
+}
+
+void Unpacker::DecompressBlock(const PakTypes::PakFileTableEntry &entry, const char *source, size_t sourceSize,
+                               char *destination, size_t destinationSize) {
+    StageTimer timer(&PakTypes::PakReadTimings::DecompressSeconds);
+
+    if (entry.CompressionType == PakTypes::CompressionType::ZLIB) {
+#ifdef USE_ZLIB
+        if (!context.zlibInitialised) {
+            if (mz_inflateInit(&context.zlib) != MZ_OK)
+                throw std::runtime_error("Failed to initialise zlib decompression");
+            context.zlibInitialised = true;
+        } else {
+            mz_inflateReset(&context.zlib);
+        }
+
+        context.zlib.next_in = reinterpret_cast<const unsigned char *>(source);
+        context.zlib.avail_in = static_cast<unsigned int>(sourceSize);
+        context.zlib.next_out = reinterpret_cast<unsigned char *>(destination);
+        context.zlib.avail_out = static_cast<unsigned int>(destinationSize);
+
+        int result = mz_inflate(&context.zlib, MZ_FINISH);
+        if (result != MZ_STREAM_END || context.zlib.total_out != destinationSize)
+            throw std::runtime_error("Failed to decompress file: " + std::string(entry.FilePath));
+#else
+        throw std::runtime_error("ZLIB compression is not supported");
+#endif
+    } else if (entry.CompressionType == PakTypes::CompressionType::LZ4) {
+#ifdef USE_LZ4
+        int decompressed_size = LZ4_decompress_safe(source, destination, static_cast<int>(sourceSize),
+                                                    static_cast<int>(destinationSize));
+        if (decompressed_size != static_cast<int>(destinationSize))
+            throw std::runtime_error("Failed to decompress file: " + std::string(entry.FilePath));
+#else
+        throw std::runtime_error("LZ4 compression is not supported");
+#endif
+    } else if (entry.CompressionType == PakTypes::CompressionType::ZSTD) {
+#ifdef USE_ZSTD
+        if (context.zstd == nullptr) {
+            context.zstd = ZSTD_createDCtx();
+            if (context.zstd == nullptr)
+                throw std::runtime_error("Failed to create ZSTD decompression context");
+        }
+
+        if (entry.PatchType == PakTypes::PatchType::PATCH_DELTA) {
+            if (context.reference == nullptr)
+                throw std::runtime_error("Patched file requires its base pak: " + std::string(entry.FilePath));
+
+            ZSTD_DCtx_refPrefix(context.zstd, context.reference, context.referenceSize);
+        }
+
+        size_t decompressed_size = ZSTD_decompressDCtx(context.zstd, destination, destinationSize, source,
+                                                       sourceSize);
+        if (ZSTD_isError(decompressed_size) || decompressed_size != destinationSize)
+            throw std::runtime_error("Failed to decompress file: " + std::string(entry.FilePath));
+#else
+        throw std::runtime_error("ZSTD compression is not supported");
+#endif
+    } else {
+        throw std::invalid_argument("Unknown compression type");
+    }
+}
+
+#ifdef USE_ENCRYPTION
+void Unpacker::PrepareEncryptionKey(const PakTypes::PakHeader &header) {
+    cipher = header.Cipher;
+
+    // The pak records the limits it was packed with, the configured ones only apply to paks without them
+    size_t opsLimit = header.KdfOpsLimit != 0 ? header.KdfOpsLimit : encryptionOpsLimit;
+    size_t memLimit = header.KdfMemLimit != 0 ? header.KdfMemLimit : encryptionMemLimit;
+
+    if (keyDerived && keyPassword == password && keyOpsLimit == opsLimit && keyMemLimit == memLimit &&
+        std::memcmp(salt, header.Salt, crypto_pwhash_SALTBYTES) == 0) {
+        return;
+    }
+
+    keyDerived = false;
+    memcpy(salt, header.Salt, crypto_pwhash_SALTBYTES);
+    Kdf::DeriveKey(key, sizeof key, password, salt, opsLimit, memLimit);
+
+    keyPassword = password;
+    keyOpsLimit = opsLimit;
+    keyMemLimit = memLimit;
+    keyDerived = true;
+}
+
+void Unpacker::Decrypt(const char *packedData, size_t packedSize, char *destination) const {
+    StageTimer timer(&PakTypes::PakReadTimings::DecryptSeconds);
+    const auto *nonce = reinterpret_cast<const unsigned char *>(packedData);
+    const auto *mac = nonce + crypto_secretbox_xchacha20poly1305_NONCEBYTES;
+
+    if (!Cipher::Open(cipher, key, nonce, mac + crypto_secretbox_xchacha20poly1305_MACBYTES,
+                      packedSize - PakTypes::EncryptionOverhead, mac, reinterpret_cast<unsigned char *>(destination))) {
+        throw std::runtime_error("Decryption failed");
+    }
+}
+
+void Unpacker::DecryptEntry(const PakTypes::PakFileTableEntry &entry, const char *packedData, char *destination) const {
+    StageTimer timer(&PakTypes::PakReadTimings::DecryptSeconds);
+
+    if (entry.EncryptionBlockSize == 0) {
+        Decrypt(packedData, entry.PackedSize, destination);
+        return;
+    }
+
+    const auto *nonce = reinterpret_cast<const unsigned char *>(packedData);
+    const char *ciphertext = packedData + crypto_secretbox_xchacha20poly1305_NONCEBYTES;
+
+    DecryptSegments(entry, nonce, ciphertext, ciphertext + PakTypes::GetDecryptedSize(entry), 0,
+                    PakTypes::GetEncryptedSegmentCount(entry), destination);
+}
+
+void Unpacker::DecryptSegments(const PakTypes::PakFileTableEntry &entry, const unsigned char *nonce,
+                               const char *ciphertext, const char *macs, size_t firstSegment, size_t segmentCount,
+                               char *destination) const {
+    StageTimer timer(&PakTypes::PakReadTimings::DecryptSeconds);
+    size_t dataSize = PakTypes::GetDecryptedSize(entry);
+    size_t lastSegment = PakTypes::GetEncryptedSegmentCount(entry) - 1;
+    unsigned char segmentNonce[crypto_secretbox_xchacha20poly1305_NONCEBYTES];
+
+    for (size_t i = 0; i < segmentCount; i++) {
+        size_t segment = firstSegment + i;
+        size_t start = i * entry.EncryptionBlockSize;
+        size_t length = std::min<size_t>(entry.EncryptionBlockSize, dataSize - segment * entry.EncryptionBlockSize);
+
+        Cipher::GetSegmentNonce(cipher, nonce, segment, segment == lastSegment, segmentNonce);
+        if (!Cipher::Open(cipher, key, segmentNonce, reinterpret_cast<const unsigned char *>(ciphertext + start),
+                          length,
+                          reinterpret_cast<const unsigned char *>(macs + i * crypto_secretbox_xchacha20poly1305_MACBYTES),
+                          reinterpret_cast<unsigned char *>(destination + start))) {
+            throw std::runtime_error("Decryption failed");
+        }
+    }
 }
 #endif
@@ -1,11 +1,26 @@
 #pragma once
 
+#include <span>
+#include <cstddef>
+#include <future>
+#include <functional>
 #include <vector>
+#include <deque>
+#include <chrono>
 #include <string>
+#include <cstring>
+#include <stdexcept>
 #include <fstream>
 #include <exception>
 #include <filesystem>
 #include "PakTypes.h"
+#include "EntryCache.h"
+#include "ThreadPool.h"
+#include "Filters.h"
+#include "Checksum.h"
+#include "MerkleTree.h"
+#include "Cipher.h"
+#include "Kdf.h"
 
 #ifdef USE_LZ4
 #include "lz4hc.h"
@@ -22,22 +37,168 @@
 
 class Unpacker {
 public:
+    using Allocator = std::function<std::byte *(size_t size)>;
+
     std::vector<char> ExtractFileToMemory(
             PakTypes::PakFile &pakFile,
             const std::string &filePath
     );
 
+    size_t ExtractFileToMemory(
+            PakTypes::PakFile &pakFile,
+            const std::string &filePath,
+            std::span<std::byte> destination
+    );
+
+    std::span<std::byte> ExtractFileToMemory(
+            PakTypes::PakFile &pakFile,
+            const std::string &filePath,
+            const Allocator &allocator
+    );
+
+    EntryCache::Buffer ExtractSharedFile(
+            PakTypes::PakFile &pakFile,
+            const std::string &filePath
+    );
+
+    std::vector<char> ExtractFileToMemory(
+            PakTypes::PakFile &pakFile,
+            const PakTypes::ResourceId &resourceId
+    );
+
+    size_t ExtractFileToMemory(
+            PakTypes::PakFile &pakFile,
+            const PakTypes::ResourceId &resourceId,
+            std::span<std::byte> destination
+    );
+
+    EntryCache::Buffer ExtractSharedFile(
+            PakTypes::PakFile &pakFile,
+            const PakTypes::ResourceId &resourceId
+    );
+
+    std::vector<std::vector<char>> ExtractMany(
+            PakTypes::PakFile &pakFile,
+            std::span<const std::string> filePaths
+    );
+
+    std::vector<std::vector<char>> ExtractMany(
+            PakTypes::PakFile &pakFile,
+            std::span<const size_t> entryIndices
+    );
+
+    std::vector<char> ReadRange(
+            PakTypes::PakFile &pakFile,
+            const std::string &filePath,
+            size_t offset,
+            size_t length
+    );
+
     void ExtractFileToDisk(
             PakTypes::PakFile &pakFile,
             const std::string &outputPath,
             const std::string &filePath
     );
 
-    static PakTypes::PakFile ParsePakFile(const std::string &inputPath);
+    // Reads a file through a patch pak mounted over the base pak it was created against
+    std::vector<char> ExtractPatchedFile(
+            PakTypes::PakFile &basePak,
+            PakTypes::PakFile &patchPak,
+            const std::string &filePath
+    );
+
+    static bool HasPatchedFile(PakTypes::PakFile &basePak, PakTypes::PakFile &patchPak, const std::string &filePath);
+
+    static void VerifyPatch(const PakTypes::PakFile &basePak, const PakTypes::PakFile &patchPak);
+
+    static std::vector<char> ReadPackedEntry(PakTypes::PakFile &pakFile, size_t entryIndex);
+
+    static PakTypes::PakFile ParsePakFile(const std::string &inputPath, bool lazy = false);
+
+    static PakTypes::PakFile ParsePakMemory(const void *data, size_t size, bool lazy = false);
+
+    // Parses the pak, derives the key and decodes the prefetch entries on a background thread. Each prefetched entry
+    // serves the first read of it and is then released. The pak's cache is left as it is.
+    // The Unpacker must not be used elsewhere until the returned future is ready.
+    std::future<PakTypes::PakFile> OpenAsync(
+            const std::string &inputPath,
+            std::vector<std::string> prefetch = {},
+            bool lazy = false
+    );
+
+    std::future<PakTypes::PakFile> OpenAsync(
+            const void *data,
+            size_t size,
+            std::vector<std::string> prefetch = {},
+            bool lazy = false
+    );
+
+    static size_t GetEntryCount(const PakTypes::PakFile &pakFile);
+
+    static const PakTypes::PakFileTableEntry &GetEntry(PakTypes::PakFile &pakFile, size_t entryIndex);
+
+    static void ForEachEntry(PakTypes::PakFile &pakFile,
+                             const std::function<void(size_t, const PakTypes::PakFileTableEntry &)> &callback);
+
+    static bool HasFile(PakTypes::PakFile &pakFile, const std::string &filePath);
+
+    static size_t FindEntryIndex(PakTypes::PakFile &pakFile, const std::string &filePath);
+
+    // Uses the baked entry index when the id was generated for this pak build, otherwise looks up the path hash.
+    static size_t FindEntryIndex(PakTypes::PakFile &pakFile, const PakTypes::ResourceId &resourceId);
+
+    static void VerifyBuildId(const PakTypes::PakFile &pakFile, uint64_t buildId);
+
+    // Checks the header's Merkle root against one stored or signed elsewhere, so a tampered pak can't supply its own
+    static void VerifyMerkleRoot(const PakTypes::PakFile &pakFile, const MerkleTree::Hash &root);
+
+    static PakTypes::PakEntryInfo GetEntryInfo(PakTypes::PakFile &pakFile, const std::string &filePath);
+
+    static void EnableCache(PakTypes::PakFile &pakFile, size_t budgetBytes);
+
+    static void DisableCache(PakTypes::PakFile &pakFile);
+
+    static EntryCache::Stats GetCacheStats(const PakTypes::PakFile &pakFile);
+
+    // Off by default. While enabled every read adds its per-stage times to the calling thread's totals.
+    static bool getCollectReadTimings();
+
+    static void setCollectReadTimings(bool enabled);
+
+    // Totals for the calling thread since its last ResetReadTimings.
+    static PakTypes::PakReadTimings GetReadTimings();
+
+    static void ResetReadTimings();
+
+    // Checks the file table for out of range or overlapping entries, then decodes every entry on the thread pool
+    // and compares its checksum. Nothing is written to disk and problems are collected instead of thrown.
+    // Patch delta and remove entries have nothing to check on their own and are counted as skipped, as are chunked
+    // patch entries, which can use chunks stored in the base pak.
+    PakTypes::PakVerifyResult VerifyPakFile(PakTypes::PakFile &pakFile);
+
+    // Checks the CRC32C of every fully decoded entry and throws on a mismatch. Partial ReadRange reads are not verified.
+    [[nodiscard]] bool getVerifyChecksums() const { return verifyChecksums; }
+
+    void setVerifyChecksums(bool enabled) { verifyChecksums = enabled; }
+
+    // Checks every block read from a pak that has a Merkle tree against the tree before using it. Throws on a mismatch.
+    [[nodiscard]] bool getVerifyMerkleTree() const { return verifyMerkleTree; }
+
+    void setVerifyMerkleTree(bool enabled) { verifyMerkleTree = enabled; }
+
+    [[nodiscard]] ThreadPool &getThreadPool() const { return threadPool ? *threadPool : ThreadPool::Shared(); }
+
+    void setThreadPool(ThreadPool *pool) { threadPool = pool; }
 
 #ifdef USE_ENCRYPTION
-    void Decrypt(std::vector<char> &dataBuffer) const;
+    // destination may be packedData + EncryptionOverhead to decrypt in place
+    void Decrypt(const char *packedData, size_t packedSize, char *destination) const;
+
+    // Decrypts an encrypted entry's packed data in either layout. destination may point at the ciphertext, which
+    // starts after the nonce (and MAC for unsegmented entries), to decrypt in place.
+    void DecryptEntry(const PakTypes::PakFileTableEntry &entry, const char *packedData, char *destination) const;
 
+    // Only used for paks that don't record the limits they were packed with
     [[nodiscard]] size_t getEncryptionOpsLimit() const { return encryptionOpsLimit; }
 
     void setEncryptionOpsLimit(size_t limit) { encryptionOpsLimit = limit; }
@@ -52,6 +213,88 @@ public:
 #endif
 
 private:
+    static constexpr size_t EntryPageSize = 64;
+    static constexpr size_t LookupPageSize = 1024;
+
+    static void ParsePakTable(PakTypes::PakFile &file, size_t fileSize, const std::string &inputPath, bool lazy);
+
+    // Checks the header and tables against the header's Merkle root and seeds the tree with the data root it covers.
+    // header must be the bytes as read, since padding is hashed too.
+    static void VerifyTables(PakTypes::PakFile &file, const PakTypes::PakHeader &header, const std::string &inputPath);
+
+    static bool ReadAt(PakTypes::PakFile &pakFile, size_t offset, void *destination, size_t size);
+
+    static const char *PeekAt(const PakTypes::PakFile &pakFile, size_t offset, size_t size);
+
+    static size_t GetPakSize(PakTypes::PakFile &pakFile);
+
+    [[nodiscard]] bool VerifiesMerkleTree(const PakTypes::PakFile &pakFile) const {
+        return verifyMerkleTree && !pakFile.MerkleLevels.empty();
+    }
+
+    // Returns a pointer to [offset, offset + size) of the data region, read into scratch unless the pak is in memory.
+    // Returns nullptr if the read fails.
+    const char *ReadData(PakTypes::PakFile &pakFile, size_t offset, size_t size, std::vector<char> &scratch) const;
+
+    // Like ReadData, but offset is relative to the entry's packed data once decrypted. Only the segments of an
+    // encrypted entry that cover the range are read and decrypted.
+    const char *ReadPacked(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, size_t offset,
+                           size_t size, std::vector<char> &scratch) const;
+
+    static void VerifyMerkleBlocks(PakTypes::PakFile &pakFile, size_t offset, const char *data, size_t size);
+
+    static void VerifyMerklePath(PakTypes::PakFile &pakFile, size_t leafIndex, MerkleTree::Hash hash);
+
+    // Returns the entries whose table records are sound enough to decode
+    static std::vector<PakTypes::PakFileTableEntry> VerifyTable(PakTypes::PakFile &pakFile,
+                                                                std::vector<std::string> &errors);
+
+    PakTypes::PakFile PrepareOpenedPak(PakTypes::PakFile pakFile, const std::vector<std::string> &prefetch);
+
+    static const PakTypes::PakLookupEntry &GetLookupEntry(PakTypes::PakFile &pakFile, size_t lookupIndex);
+
+    static size_t FindLookupIndex(PakTypes::PakFile &pakFile, uint64_t pathHash);
+
+    void ExtractIndexedEntry(PakTypes::PakFile &pakFile, size_t entryIndex, char *destination);
+
+    EntryCache::Buffer ExtractCachedEntry(PakTypes::PakFile &pakFile, size_t entryIndex);
+
+    static EntryCache::Buffer TakePrefetched(PakTypes::PakFile &pakFile, size_t entryIndex);
+
+    static constexpr size_t MaxCoalesceGap = 64 * 1024;
+    static constexpr size_t MaxCoalescedRead = 32 * 1024 * 1024;
+    static constexpr size_t MaxVerifyInFlight = 256 * 1024 * 1024;
+
+    ThreadPool *threadPool = nullptr;
+
+    bool verifyChecksums = false;
+    bool verifyMerkleTree = false;
+
+    void VerifyChecksum(const PakTypes::PakFileTableEntry &entry, const char *data) const;
+
+    void ExtractEntry(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, char *destination);
+
+    // Decodes a large segmented encrypted entry a bounded piece at a time instead of reading it whole
+    void StreamEntry(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, char *destination) const;
+
+    // Decodes the blocks of a seekable compressed entry that overlap [offset, offset + length) into destination
+    void ReadBlocks(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, size_t offset,
+                    size_t length, char *destination) const;
+
+    // packedData may be overwritten when decryptInPlace is set, saving a copy into the scratch buffer
+    void DecodeEntry(const PakTypes::PakFileTableEntry &entry, const char *packedData, char *destination,
+                     bool decryptInPlace = false) const;
+
+    // Decodes the chunks of a chunked entry that overlap [offset, offset + length) into destination
+    void ReadChunks(PakTypes::PakFile &pakFile, const PakTypes::PakFileTableEntry &entry, size_t offset,
+                    size_t length, char *destination) const;
+
+    static void Decompress(const PakTypes::PakFileTableEntry &entry, const char *source, size_t sourceSize,
+                           char *destination);
+
+    static void DecompressBlock(const PakTypes::PakFileTableEntry &entry, const char *source, size_t sourceSize,
+                                char *destination, size_t destinationSize);
+
 #ifdef USE_ENCRYPTION
     size_t encryptionOpsLimit = crypto_pwhash_OPSLIMIT_MIN;
     size_t encryptionMemLimit = crypto_pwhash_MEMLIMIT_MIN;
@@ -59,7 +302,16 @@ private:
     std::string password;
     unsigned char salt[crypto_pwhash_SALTBYTES];
     unsigned char key[crypto_secretbox_xchacha20poly1305_KEYBYTES];
+    PakTypes::CipherType cipher = PakTypes::CipherType::XCHACHA20_POLY1305;
+
+    bool keyDerived = false;
+    std::string keyPassword;
+    size_t keyOpsLimit = 0;
+    size_t keyMemLimit = 0;
+
+    void PrepareEncryptionKey(const PakTypes::PakHeader &header);
 
-    void GenerateEncryptionKey();
+    void DecryptSegments(const PakTypes::PakFileTableEntry &entry, const unsigned char *nonce, const char *ciphertext,
+                         const char *macs, size_t firstSegment, size_t segmentCount, char *destination) const;
 #endif
 };
\ No newline at end of file
@@ -119,6 +119,10 @@ public:
     }
 
     static std::string GetCurrentWorkingDirectory() {
+        return GetExecutableDirectory();
+    }
+
+    static std::string GetExecutableDirectory() {
         char buffer[MAX_PATH];
         GetModuleFileName(nullptr, buffer, MAX_PATH);
         std::string path(buffer);
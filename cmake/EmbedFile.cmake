@@ -0,0 +1,18 @@
+# Usage: cmake -DINPUT=<file> -DOUTPUT=<source.cpp> -DSYMBOL=<name> -P EmbedFile.cmake
+#
+# Generates a C++ source defining `const unsigned char <SYMBOL>Data[]` and `const size_t <SYMBOL>Size`
+# with the contents of INPUT, so it can be linked straight into an executable.
+
+if (NOT INPUT OR NOT OUTPUT OR NOT SYMBOL)
+    message(FATAL_ERROR "EmbedFile.cmake requires INPUT, OUTPUT and SYMBOL")
+endif ()
+
+file(READ "${INPUT}" content HEX)
+file(SIZE "${INPUT}" size)
+
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${content}")
+
+file(WRITE "${OUTPUT}"
+        "#include <cstddef>\n\n"
+        "alignas(16) extern const unsigned char ${SYMBOL}Data[] = {\n    ${bytes}\n};\n\n"
+        "extern const size_t ${SYMBOL}Size = ${size};\n")
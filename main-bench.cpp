@@ -0,0 +1,556 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Packer.h"
+#include "Unpacker.h"
+#include "Paths.h"
+#include "Json.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+struct Corpus {
+    std::string name;
+    std::vector<PakTypes::PakFileItem> files;
+    uint64_t bytes = 0;
+};
+
+struct Codec {
+    PakTypes::CompressionType type;
+    std::vector<int> levels;
+};
+
+struct Result {
+    std::string corpus;
+    PakTypes::CompressionType codec;
+    int level;
+    size_t files;
+    uint64_t originalBytes;
+    uint64_t packedBytes;
+    double ratio;
+    double packMBps;
+    double compressMBps;
+    double decompressMBps;
+    double peakRssMB;
+};
+
+static const char *Usage =
+        "Usage: res_packer_bench [options]\n"
+        "\n"
+        "Packs each corpus with every codec and level and reports the ratio, compression and decompression speed\n"
+        "and peak memory use.\n"
+        "\n"
+        "  --corpus <name|dir>        text, binary, random, floats or a directory of real files. Repeatable.\n"
+        "                             (default: the four generated corpora)\n"
+        "  --size <MiB>               Size of each generated corpus (default: 32)\n"
+        "  --seed <n>                 Seed for the generated corpora (default: 1)\n"
+        "  --codec <zlib|lz4|zstd>    Repeatable (default: all three)\n"
+        "  --levels <a,b,...>         Levels for the codecs given before it (default: a spread per codec)\n"
+        "  --filter <none|shuffle|delta|xor-delta>\n"
+        "                             Filter for the floats corpus (default: none)\n"
+        "  --block-size <KiB>         Seekable block size, 0 compresses files whole (default: 256)\n"
+        "  --repeat <n>               Best of n runs (default: 3)\n"
+        "  --work <dir>               Scratch directory for generated files and paks (default: system temp)\n"
+        "  --csv <path>               Also write the results as CSV\n"
+        "  --json <path>              Also write the results as JSON\n"
+        "  -h, --help                 Show this message\n";
+
+// Peak resident set size in bytes. On Linux it's reset between runs so each result reports its own peak, elsewhere
+// it's the process peak so far.
+static uint64_t GetPeakRss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters);
+    return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::stoull(line.substr(6)) * 1024;
+    }
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static void ResetPeakRss() {
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+static double MegabytesPerSecond(uint64_t bytes, double seconds) {
+    return seconds > 0.0 ? static_cast<double>(bytes) / 1e6 / seconds : 0.0;
+}
+
+static PakTypes::CompressionType ParseCodec(const std::string &name) {
+    if (name == "zlib")
+        return PakTypes::CompressionType::ZLIB;
+    if (name == "lz4")
+        return PakTypes::CompressionType::LZ4;
+    if (name == "zstd")
+        return PakTypes::CompressionType::ZSTD;
+
+    throw std::runtime_error("Unknown codec: " + name);
+}
+
+static PakTypes::FilterType ParseFilter(const std::string &name) {
+    if (name == "none")
+        return PakTypes::FilterType::UNFILTERED;
+    if (name == "shuffle")
+        return PakTypes::FilterType::SHUFFLE;
+    if (name == "delta")
+        return PakTypes::FilterType::DELTA;
+    if (name == "xor-delta")
+        return PakTypes::FilterType::XOR_DELTA;
+
+    throw std::runtime_error("Unknown filter: " + name);
+}
+
+static std::vector<int> DefaultLevels(PakTypes::CompressionType type) {
+    switch (type) {
+        case PakTypes::CompressionType::ZLIB:
+            return {1, 6, 9};
+        case PakTypes::CompressionType::LZ4:
+            return {1, 8, 12};
+        default:
+            return {1, 3, 8, 19};
+    }
+}
+
+static std::vector<int> ParseLevels(const std::string &value) {
+    std::vector<int> levels;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        std::string level = value.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        levels.push_back(std::stoi(level));
+        if (comma == std::string::npos)
+            break;
+        start = comma + 1;
+    }
+    return levels;
+}
+
+// File sizes are log-uniform between 4 KiB and 1 MiB, roughly what a game's loose assets look like
+static std::vector<size_t> GenerateSizes(std::mt19937_64 &random, uint64_t totalBytes) {
+    std::uniform_real_distribution<double> exponent(12.0, 20.0);
+    std::vector<size_t> sizes;
+
+    uint64_t remaining = totalBytes;
+    while (remaining > 0) {
+        auto size = static_cast<size_t>(std::min<double>(std::exp2(exponent(random)), static_cast<double>(remaining)));
+        sizes.push_back(size);
+        remaining -= size;
+    }
+    return sizes;
+}
+
+// Words drawn from a Zipf-like vocabulary, so common words repeat the way they do in real text
+static void GenerateText(std::mt19937_64 &random, std::vector<char> &data, size_t size) {
+    static const char *syllables[] = {"ka", "to", "ri", "ne", "sha", "lo", "mi", "dar", "en", "vi", "qu", "bel",
+                                      "or", "an", "th", "is", "re", "ul", "mon", "ge"};
+    std::vector<std::string> vocabulary;
+    std::uniform_int_distribution<size_t> syllable(0, std::size(syllables) - 1);
+    std::uniform_int_distribution<int> syllableCount(1, 4);
+    for (int i = 0; i < 4096; i++) {
+        std::string word;
+        for (int j = syllableCount(random); j > 0; j--)
+            word += syllables[syllable(random)];
+        vocabulary.push_back(word);
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    size_t wordsInLine = 0;
+    while (data.size() < size) {
+        auto rank = static_cast<size_t>(std::pow(static_cast<double>(vocabulary.size()), uniform(random))) - 1;
+        const std::string &word = vocabulary[std::min(rank, vocabulary.size() - 1)];
+        data.insert(data.end(), word.begin(), word.end());
+
+        if (++wordsInLine >= 12 && uniform(random) < 0.2) {
+            data.push_back('.');
+            data.push_back('\n');
+            wordsInLine = 0;
+        } else {
+            data.push_back(' ');
+        }
+    }
+}
+
+// Fixed-size records with incrementing ids, a few flag values and slowly changing fields, like serialized game data
+static void GenerateBinary(std::mt19937_64 &random, std::vector<char> &data, size_t size) {
+    struct Record {
+        uint32_t Id;
+        uint16_t Type;
+        uint16_t Flags;
+        int32_t Position[3];
+        uint32_t Color;
+        char Name[16];
+    };
+
+    std::uniform_int_distribution<int> step(-64, 64);
+    std::uniform_int_distribution<uint16_t> type(0, 7);
+    std::uniform_int_distribution<uint32_t> color(0, 15);
+    Record record{};
+    while (data.size() < size) {
+        record.Id++;
+        record.Type = type(random);
+        record.Flags = record.Type < 2 ? 0x8001 : 0;
+        for (int32_t &axis: record.Position)
+            axis += step(random);
+        record.Color = 0xFF000000u | color(random) * 0x111111u;
+        std::snprintf(record.Name, sizeof record.Name, "entity_%u", record.Id % 1000);
+
+        const char *bytes = reinterpret_cast<const char *>(&record);
+        data.insert(data.end(), bytes, bytes + sizeof record);
+    }
+}
+
+static void GenerateRandom(std::mt19937_64 &random, std::vector<char> &data, size_t size) {
+    while (data.size() < size) {
+        uint64_t value = random();
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof value);
+    }
+}
+
+// Smooth noisy signals, like vertex positions or animation curves
+static void GenerateFloats(std::mt19937_64 &random, std::vector<char> &data, size_t size) {
+    std::uniform_real_distribution<float> frequency(0.001f, 0.05f);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    float step = frequency(random);
+    for (size_t i = 0; data.size() < size; i++) {
+        float value = std::sin(static_cast<float>(i) * step) * 100.0f + noise(random);
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof value);
+    }
+}
+
+static Corpus GenerateCorpus(const std::string &name, const fs::path &workDirectory, uint64_t totalBytes,
+                             uint64_t seed, PakTypes::FilterType floatFilter) {
+    void (*generate)(std::mt19937_64 &, std::vector<char> &, size_t);
+    if (name == "text")
+        generate = GenerateText;
+    else if (name == "binary")
+        generate = GenerateBinary;
+    else if (name == "random")
+        generate = GenerateRandom;
+    else if (name == "floats")
+        generate = GenerateFloats;
+    else
+        throw std::runtime_error("Not a directory or a generated corpus: " + name);
+
+    Corpus corpus;
+    corpus.name = name;
+
+    fs::path directory = workDirectory / name;
+    fs::create_directories(directory);
+
+    std::mt19937_64 random(seed ^ std::hash<std::string>()(name));
+    std::vector<size_t> sizes = GenerateSizes(random, totalBytes);
+    for (size_t i = 0; i < sizes.size(); i++) {
+        // Generators append whole values, so they can overshoot the size a little
+        std::vector<char> data;
+        data.reserve(sizes[i] + 64);
+        generate(random, data, sizes[i]);
+        data.resize(sizes[i]);
+
+        std::string fileName = std::to_string(i) + ".bin";
+        fs::path path = directory / fileName;
+        std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+
+        corpus.files.push_back({
+                .name = fileName,
+                .path = path.string(),
+                .packedPath = name + "/" + fileName,
+                .size = data.size(),
+                .compressed = true,
+                .filter = name == "floats" ? floatFilter : PakTypes::FilterType::UNFILTERED
+        });
+        corpus.bytes += data.size();
+    }
+
+    return corpus;
+}
+
+static Corpus LoadCorpus(const std::string &directory) {
+    Corpus corpus;
+    corpus.name = fs::path(directory).lexically_normal().filename().string();
+    if (corpus.name.empty())
+        corpus.name = fs::absolute(directory).parent_path().filename().string();
+
+    std::vector<std::string> paths;
+    Paths::getFiles(directory, paths);
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto &path: paths) {
+        std::string packedPath = fs::relative(path, directory).string();
+        Paths::ReplaceSlashes(packedPath);
+
+        corpus.files.push_back({
+                .name = Paths::GetFileName(path),
+                .path = path,
+                .packedPath = packedPath,
+                .size = Paths::GetFileSize(path),
+                .compressed = true
+        });
+        corpus.bytes += corpus.files.back().size;
+    }
+
+    if (corpus.files.empty())
+        throw std::runtime_error("No files in corpus: " + directory);
+
+    return corpus;
+}
+
+static void SetCompressionLevel(Packer &packer, PakTypes::CompressionType type, int level) {
+    if (type == PakTypes::CompressionType::ZLIB)
+        packer.setZlibCompressionLevel(level);
+    else if (type == PakTypes::CompressionType::LZ4)
+        packer.setLz4CompressionLevel(level);
+    else
+        packer.setZstdCompressionLevel(level);
+}
+
+static Result Run(const Corpus &corpus, PakTypes::CompressionType codec, int level, size_t blockSize, int repeat,
+                  const fs::path &pakPath) {
+    Result result{};
+    result.corpus = corpus.name;
+    result.codec = codec;
+    result.level = level;
+    result.files = corpus.files.size();
+
+    ResetPeakRss();
+
+    Packer packer;
+    SetCompressionLevel(packer, codec, level);
+    packer.setSeekableBlockSize(blockSize);
+
+    double packSeconds = INFINITY, compressSeconds = INFINITY;
+    for (int i = 0; i < repeat; i++) {
+        if (!packer.CreatePakFile(corpus.files, pakPath.string(), codec))
+            throw std::runtime_error("Failed to pack " + corpus.name);
+
+        const PakTypes::PakPackStats &stats = packer.getStats();
+        packSeconds = std::min(packSeconds, stats.Seconds);
+        compressSeconds = std::min(compressSeconds, stats.CompressSeconds);
+        result.originalBytes = stats.OriginalBytes;
+        result.packedBytes = stats.PackedBytes;
+    }
+
+    Unpacker unpacker;
+    PakTypes::PakFile pakFile = Unpacker::ParsePakFile(pakPath.string());
+
+    // Baked ids skip the path lookup, and the read timings leave out I/O, so only decompression is measured
+    std::vector<PakTypes::ResourceId> entries;
+    size_t largestEntry = 0;
+    Unpacker::ForEachEntry(pakFile, [&](size_t index, const PakTypes::PakFileTableEntry &entry) {
+        entries.push_back({PakTypes::HashPath(entry.FilePath), pakFile.Header.BuildId, index, entry.Offset});
+        largestEntry = std::max<size_t>(largestEntry, entry.OriginalSize);
+    });
+
+    std::vector<std::byte> buffer(largestEntry);
+    double decompressSeconds = INFINITY;
+    Unpacker::setCollectReadTimings(true);
+    for (int i = 0; i < repeat; i++) {
+        uint64_t extractedBytes = 0;
+        double before = Unpacker::GetReadTimings().DecompressSeconds;
+        for (const auto &entry: entries)
+            extractedBytes += unpacker.ExtractFileToMemory(pakFile, entry, std::span<std::byte>(buffer));
+        decompressSeconds = std::min(decompressSeconds, Unpacker::GetReadTimings().DecompressSeconds - before);
+
+        if (extractedBytes != result.originalBytes)
+            throw std::runtime_error("Extracted " + std::to_string(extractedBytes) + " of " +
+                                     std::to_string(result.originalBytes) + " bytes from " + corpus.name);
+    }
+    Unpacker::setCollectReadTimings(false);
+
+    result.ratio = result.packedBytes > 0
+                   ? static_cast<double>(result.originalBytes) / static_cast<double>(result.packedBytes) : 0.0;
+    result.packMBps = MegabytesPerSecond(result.originalBytes, packSeconds);
+    result.compressMBps = MegabytesPerSecond(result.originalBytes, compressSeconds);
+    result.decompressMBps = MegabytesPerSecond(result.originalBytes, decompressSeconds);
+    result.peakRssMB = static_cast<double>(GetPeakRss()) / (1024.0 * 1024.0);
+
+    return result;
+}
+
+static void WriteCsv(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream csv(path, std::ios::binary);
+    csv << "corpus,codec,level,files,original_bytes,packed_bytes,ratio,pack_mbps,compress_mbps,decompress_mbps,"
+           "peak_rss_mib\n";
+
+    for (const auto &result: results) {
+        char line[512];
+        std::snprintf(line, sizeof line, "%s,%s,%d,%zu,%llu,%llu,%.4f,%.2f,%.2f,%.2f,%.1f\n", result.corpus.c_str(),
+                      Packer::CompressionTypeToString(result.codec), result.level, result.files,
+                      static_cast<unsigned long long>(result.originalBytes),
+                      static_cast<unsigned long long>(result.packedBytes), result.ratio, result.packMBps,
+                      result.compressMBps, result.decompressMBps, result.peakRssMB);
+        csv << line;
+    }
+
+    if (!csv)
+        throw std::runtime_error("Failed to write " + path);
+}
+
+static void WriteJson(const std::string &path, const std::vector<Result> &results, int repeat, size_t blockSize) {
+    Json report = Json::MakeObject();
+    report["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+    report["repeat"] = repeat;
+    report["blockSize"] = blockSize;
+    report["results"] = Json::MakeArray();
+
+    for (const auto &result: results) {
+        Json row = Json::MakeObject();
+        row["corpus"] = result.corpus;
+        row["codec"] = Packer::CompressionTypeToString(result.codec);
+        row["level"] = result.level;
+        row["files"] = result.files;
+        row["originalBytes"] = result.originalBytes;
+        row["packedBytes"] = result.packedBytes;
+        row["ratio"] = result.ratio;
+        row["packMBps"] = result.packMBps;
+        row["compressMBps"] = result.compressMBps;
+        row["decompressMBps"] = result.decompressMBps;
+        row["peakRssMiB"] = result.peakRssMB;
+        report["results"].Append(row);
+    }
+
+    std::ofstream json(path, std::ios::binary);
+    json << report.Dump() << '\n';
+    if (!json)
+        throw std::runtime_error("Failed to write " + path);
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> corpusNames;
+    std::vector<Codec> codecs;
+    uint64_t corpusBytes = 32ull * 1024 * 1024;
+    uint64_t seed = 1;
+    PakTypes::FilterType floatFilter = PakTypes::FilterType::UNFILTERED;
+    size_t blockSize = 256 * 1024;
+    int repeat = 3;
+    fs::path workDirectory = fs::temp_directory_path() / "res_packer_bench";
+    std::string csvPath, jsonPath;
+
+    try {
+        size_t codecsWithLevels = 0;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("Missing value for " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "-h" || arg == "--help") {
+                std::cout << Usage;
+                return 0;
+            } else if (arg == "--corpus") {
+                corpusNames.push_back(value());
+            } else if (arg == "--size") {
+                corpusBytes = std::stoull(value()) * 1024 * 1024;
+            } else if (arg == "--seed") {
+                seed = std::stoull(value());
+            } else if (arg == "--codec") {
+                PakTypes::CompressionType type = ParseCodec(value());
+                codecs.push_back({type, DefaultLevels(type)});
+            } else if (arg == "--levels") {
+                std::vector<int> levels = ParseLevels(value());
+                if (codecs.size() == codecsWithLevels)
+                    throw std::runtime_error("--levels must follow the --codec it applies to");
+                for (; codecsWithLevels < codecs.size(); codecsWithLevels++)
+                    codecs[codecsWithLevels].levels = levels;
+            } else if (arg == "--filter") {
+                floatFilter = ParseFilter(value());
+            } else if (arg == "--block-size") {
+                blockSize = std::stoull(value()) * 1024;
+            } else if (arg == "--repeat") {
+                repeat = std::max(std::stoi(value()), 1);
+            } else if (arg == "--work") {
+                workDirectory = value();
+            } else if (arg == "--csv") {
+                csvPath = value();
+            } else if (arg == "--json") {
+                jsonPath = value();
+            } else {
+                throw std::runtime_error("Unknown option: " + arg);
+            }
+        }
+
+        if (corpusNames.empty())
+            corpusNames = {"text", "binary", "random", "floats"};
+        if (codecs.empty()) {
+            for (auto type: {PakTypes::CompressionType::ZLIB, PakTypes::CompressionType::LZ4,
+                             PakTypes::CompressionType::ZSTD})
+                codecs.push_back({type, DefaultLevels(type)});
+        }
+
+        fs::create_directories(workDirectory);
+
+        std::vector<Corpus> corpora;
+        for (const auto &name: corpusNames) {
+            corpora.push_back(fs::is_directory(name)
+                              ? LoadCorpus(name)
+                              : GenerateCorpus(name, workDirectory, corpusBytes, seed, floatFilter));
+        }
+
+        std::printf("%-10s %-5s %5s %12s %8s %10s %10s %10s %9s\n", "corpus", "codec", "level", "bytes", "ratio",
+                    "pack MB/s", "comp MB/s", "dec MB/s", "RSS MiB");
+
+        std::vector<Result> results;
+        fs::path pakPath = workDirectory / "bench.pak";
+        for (const auto &corpus: corpora) {
+            for (const auto &codec: codecs) {
+                for (int level: codec.levels) {
+                    Result result = Run(corpus, codec.type, level, blockSize, repeat, pakPath);
+                    std::printf("%-10s %-5s %5d %12llu %8.3f %10.1f %10.1f %10.1f %9.1f\n", result.corpus.c_str(),
+                                Packer::CompressionTypeToString(result.codec), result.level,
+                                static_cast<unsigned long long>(result.originalBytes), result.ratio, result.packMBps,
+                                result.compressMBps, result.decompressMBps, result.peakRssMB);
+                    std::fflush(stdout);
+                    results.push_back(result);
+                }
+            }
+        }
+
+        fs::remove(pakPath);
+
+        if (!csvPath.empty())
+            WriteCsv(csvPath, results);
+        if (!jsonPath.empty())
+            WriteJson(jsonPath, results, repeat, blockSize);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
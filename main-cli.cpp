@@ -0,0 +1,711 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Packer.h"
+#include "Unpacker.h"
+#include "Project.h"
+#include "Paths.h"
+#include "Json.h"
+
+namespace fs = std::filesystem;
+
+struct CompressionRuleSpec {
+    std::string extension;
+    bool compressed = true;
+    PakTypes::CompressionType type = PakTypes::CompressionType::ZSTD;
+    std::optional<int> level;
+};
+
+struct Job {
+    std::string name;
+    std::string output;
+    std::string base;
+    std::vector<PakTypes::PakFileItem> files;
+    // Everything the update mode compares against the output's timestamp besides the files themselves
+    std::vector<std::string> inputs;
+    PakTypes::CompressionType compressionType = PakTypes::CompressionType::ZSTD;
+    std::optional<int> level;
+    std::vector<CompressionRuleSpec> rules;
+    bool cookImages = false;
+    bool minifyJson = false;
+    bool normalizeText = false;
+    std::string cache;
+    bool update = false;
+    bool chunking = false;
+    bool merkleTree = false;
+    bool verify = false;
+    PakTypes::CipherType cipher = PakTypes::CipherType::XCHACHA20_POLY1305;
+    size_t opsLimit = crypto_pwhash_OPSLIMIT_MIN;
+    size_t memLimit = crypto_pwhash_MEMLIMIT_MIN;
+    std::string password;
+};
+
+static const char *Usage =
+        "Usage: res_packer <project.pakproj | directory | jobs.json> [options]\n"
+        "\n"
+        "  -o, --output <pak>         Pak to write for a project or directory (default: beside the input)\n"
+        "  -b, --base <pak>           Write a patch against this pak instead of a full pak\n"
+        "  -j, --threads <n>          Worker threads shared by every job (default: one per core)\n"
+        "  -c, --codec <codec>        zlib, lz4 or zstd (default: the project's codec, or zstd)\n"
+        "  -l, --level <n>            Compression level for the codec\n"
+        "  -r, --rule <ext>=<codec>[:<level>]\n"
+        "                             Codec for files with this extension, \"none\" stores them. Repeatable.\n"
+        "      --cook <images|json|text>\n"
+        "                             Cook images to RGBA, minify JSON or normalize text. Repeatable.\n"
+        "      --cache <dir>          Reuse cooked files from this directory across runs\n"
+        "  -u, --update               Skip jobs whose output is newer than all of their inputs\n"
+        "      --chunking             Store identical chunks of unencrypted files once\n"
+        "      --merkle-tree          Store a Merkle tree over the data region and tables\n"
+        "      --cipher <cipher>      xchacha20-poly1305 or aes256-gcm for encrypted files\n"
+        "      --verify               Decode and check every entry after packing\n"
+        "      --report <path>        Write the JSON report to a file instead of stdout\n"
+        "  -h, --help                 Show this message\n"
+        "\n"
+        "Encrypted files use the password in RES_PACKER_PASSWORD unless the job sets one.\n"
+        "A jobs file holds {\"threads\": n, \"defaults\": {...}, \"jobs\": [{...}, ...]}, where each job takes\n"
+        "\"project\" or \"directory\", \"output\" and the long option names above in camelCase, with \"rules\"\n"
+        "as an object of extension to codec. Command line options override the file. Directory jobs compress\n"
+        "every file unless \"compressed\" is false and encrypt them when \"encrypted\" is true.\n";
+
+static std::mutex logMutex;
+
+static void Log(const std::string &message) {
+    std::lock_guard lock(logMutex);
+    std::cerr << message << std::endl;
+}
+
+static std::string ToLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return value;
+}
+
+static std::optional<PakTypes::CompressionType> ParseCodec(const std::string &name) {
+    std::string codec = ToLower(name);
+    if (codec == "none")
+        return std::nullopt;
+    if (codec == "zlib")
+        return PakTypes::CompressionType::ZLIB;
+    if (codec == "lz4")
+        return PakTypes::CompressionType::LZ4;
+    if (codec == "zstd")
+        return PakTypes::CompressionType::ZSTD;
+
+    throw std::runtime_error("Unknown codec: " + name);
+}
+
+static PakTypes::CipherType ParseCipher(const std::string &name) {
+    std::string cipher = ToLower(name);
+    if (cipher == "xchacha20-poly1305" || cipher == "xchacha20")
+        return PakTypes::CipherType::XCHACHA20_POLY1305;
+    if (cipher == "aes256-gcm" || cipher == "aes256gcm")
+        return PakTypes::CipherType::AES256_GCM;
+
+    throw std::runtime_error("Unknown cipher: " + name);
+}
+
+static int ParseInt(const std::string &value, const std::string &option) {
+    size_t end = 0;
+    int result = 0;
+    try {
+        result = std::stoi(value, &end);
+    } catch (const std::exception &) {
+        end = std::string::npos;
+    }
+
+    if (end != value.size())
+        throw std::runtime_error("Expected a number for " + option + ": " + value);
+    return result;
+}
+
+// "<codec>[:<level>]", as used by --rule and the rules object of a job
+static CompressionRuleSpec ParseRule(const std::string &extension, const std::string &value) {
+    CompressionRuleSpec rule;
+    rule.extension = extension;
+
+    size_t colon = value.find(':');
+    std::optional<PakTypes::CompressionType> codec = ParseCodec(value.substr(0, colon));
+    rule.compressed = codec.has_value();
+    if (codec)
+        rule.type = *codec;
+    if (colon != std::string::npos)
+        rule.level = ParseInt(value.substr(colon + 1), "rule " + extension);
+
+    return rule;
+}
+
+static bool GetBool(const Json &settings, const char *key) {
+    const Json *value = settings.Find(key);
+    return value && value->AsBool();
+}
+
+static std::string GetString(const Json &settings, const char *key) {
+    const Json *value = settings.Find(key);
+    return value ? value->AsString() : std::string();
+}
+
+// Later layers replace earlier ones key by key, except rules which are merged by extension
+static Json Merge(const Json &base, const Json &overlay) {
+    Json merged = base.IsNull() ? Json::MakeObject() : base;
+
+    for (const auto &[key, value]: overlay.AsObject()) {
+        if (key == "rules" && merged.Find("rules")) {
+            for (const auto &[extension, rule]: value.AsObject())
+                merged[key][extension] = rule;
+        } else {
+            merged[key] = value;
+        }
+    }
+
+    return merged;
+}
+
+// Makes the path options of a job absolute, relative to the file or directory that defined them
+static void ResolvePaths(Json &settings, const fs::path &root) {
+    for (const char *key: {"project", "directory", "output", "base", "cache"}) {
+        const Json *value = settings.Find(key);
+        if (value && !value->AsString().empty())
+            settings[key] = fs::absolute(root / value->AsString()).lexically_normal().string();
+    }
+}
+
+static void AddDirectoryFiles(Job &job, const std::string &directory, bool compressed, bool encrypted) {
+    if (!fs::is_directory(directory))
+        throw std::runtime_error("Not a directory: " + directory);
+
+    job.inputs.push_back(directory);
+
+    std::vector<fs::path> paths;
+    for (const auto &entry: fs::recursive_directory_iterator(directory)) {
+        if (entry.is_directory())
+            job.inputs.push_back(entry.path().string());
+        else if (entry.is_regular_file())
+            paths.push_back(entry.path());
+    }
+
+    // Directory iteration order is unspecified, sorting keeps the pak layout stable between runs
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto &path: paths) {
+        std::string packedPath = fs::relative(path, directory).string();
+        Paths::ReplaceSlashes(packedPath);
+
+        job.files.push_back({
+                .name = Paths::GetFileName(path.string()),
+                .path = path.string(),
+                .packedPath = packedPath,
+                .size = Paths::GetFileSize(path.string()),
+                .compressed = compressed,
+                .encrypted = encrypted
+        });
+    }
+}
+
+static Job CreateJob(const Json &settings) {
+    Job job;
+
+    std::string project = GetString(settings, "project");
+    std::string directory = GetString(settings, "directory");
+    if (project.empty() == directory.empty())
+        throw std::runtime_error("A job needs either a project or a directory");
+
+    const Json *compressed = settings.Find("compressed");
+    const Json *encrypted = settings.Find("encrypted");
+
+    if (!project.empty()) {
+        ProjectFile projectFile = ProjectFile::Load(project);
+        job.compressionType = projectFile.compressionType;
+        job.files = projectFile.files;
+        job.inputs.push_back(project);
+
+        // Relative file paths in a project are relative to the directory the GUI was started from, which a build
+        // script can't know, so they are resolved against the project instead
+        for (auto &file: job.files) {
+            if (fs::path(file.path).is_relative())
+                file.path = (fs::path(project).parent_path() / file.path).string();
+            if (compressed)
+                file.compressed = compressed->AsBool();
+            if (encrypted)
+                file.encrypted = encrypted->AsBool();
+        }
+    } else {
+        AddDirectoryFiles(job, directory, !compressed || compressed->AsBool(), encrypted && encrypted->AsBool());
+    }
+
+    fs::path input = project.empty() ? fs::path(directory) : fs::path(project);
+    job.output = GetString(settings, "output");
+    if (job.output.empty()) {
+        std::string name = project.empty() ? input.filename().string() : input.stem().string();
+        job.output = (input.parent_path() / (name + ".pak")).string();
+    }
+    job.name = GetString(settings, "name");
+    if (job.name.empty())
+        job.name = fs::path(job.output).filename().string();
+
+    job.base = GetString(settings, "base");
+    if (!job.base.empty())
+        job.inputs.push_back(job.base);
+
+    if (const Json *codec = settings.Find("codec")) {
+        std::optional<PakTypes::CompressionType> type = ParseCodec(codec->AsString());
+        if (!type)
+            throw std::runtime_error("The pak codec can't be none, use a rule or \"compressed\": false instead");
+        job.compressionType = *type;
+    }
+    if (const Json *level = settings.Find("level"))
+        job.level = static_cast<int>(level->AsInt());
+
+    if (const Json *rules = settings.Find("rules")) {
+        for (const auto &[extension, rule]: rules->AsObject())
+            job.rules.push_back(ParseRule(extension, rule.AsString()));
+    }
+
+    if (const Json *cook = settings.Find("cook")) {
+        for (const auto &value: cook->AsArray()) {
+            std::string cookType = ToLower(value.AsString());
+            if (cookType == "images")
+                job.cookImages = true;
+            else if (cookType == "json")
+                job.minifyJson = true;
+            else if (cookType == "text")
+                job.normalizeText = true;
+            else
+                throw std::runtime_error("Unknown cook type: " + value.AsString());
+        }
+    }
+
+    job.cache = GetString(settings, "cache");
+    job.update = GetBool(settings, "update");
+    job.chunking = GetBool(settings, "chunking");
+    job.merkleTree = GetBool(settings, "merkleTree");
+    job.verify = GetBool(settings, "verify");
+
+    if (const Json *cipher = settings.Find("cipher"))
+        job.cipher = ParseCipher(cipher->AsString());
+    if (const Json *opsLimit = settings.Find("kdfOpsLimit"))
+        job.opsLimit = static_cast<size_t>(opsLimit->AsInt());
+    if (const Json *memLimit = settings.Find("kdfMemLimit"))
+        job.memLimit = static_cast<size_t>(memLimit->AsInt());
+
+    job.password = GetString(settings, "password");
+    if (job.password.empty()) {
+        if (const char *password = std::getenv("RES_PACKER_PASSWORD"))
+            job.password = password;
+    }
+
+    bool hasEncryptedItem = std::any_of(job.files.begin(), job.files.end(), [](const PakTypes::PakFileItem &item) {
+        return item.encrypted;
+    });
+    if (hasEncryptedItem && job.password.empty())
+        throw std::runtime_error(job.name + " has encrypted files but no password, set RES_PACKER_PASSWORD");
+
+    return job;
+}
+
+static bool IsUpToDate(const Job &job) {
+    std::error_code error;
+    auto outputTime = fs::last_write_time(job.output, error);
+    if (error)
+        return false;
+
+    auto isOlder = [&](const std::string &path) {
+        auto inputTime = fs::last_write_time(path, error);
+        return !error && inputTime <= outputTime;
+    };
+
+    return std::all_of(job.inputs.begin(), job.inputs.end(), isOlder) &&
+           std::all_of(job.files.begin(), job.files.end(), [&](const PakTypes::PakFileItem &file) {
+               return isOlder(file.path);
+           });
+}
+
+static void SetCompressionLevel(Packer &packer, PakTypes::CompressionType type, int level) {
+    if (type == PakTypes::CompressionType::ZLIB)
+        packer.setZlibCompressionLevel(level);
+    else if (type == PakTypes::CompressionType::LZ4)
+        packer.setLz4CompressionLevel(level);
+    else
+        packer.setZstdCompressionLevel(level);
+}
+
+static void ConfigurePacker(Packer &packer, Job &job, ThreadPool &pool) {
+    packer.setThreadPool(&pool);
+
+    if (job.level)
+        SetCompressionLevel(packer, job.compressionType, *job.level);
+
+    for (const auto &spec: job.rules) {
+        Packer::CompressionRule rule;
+        rule.Compressed = spec.compressed;
+        rule.Type = spec.type;
+        rule.Level = spec.level ? *spec.level : packer.GetCompressionLevel(spec.type);
+        packer.AddCompressionRule(spec.extension, rule);
+    }
+
+    Cooker &cooker = packer.getCooker();
+    cooker.AddDefaultRules(job.cookImages, job.minifyJson, job.normalizeText);
+    cooker.setCacheDirectory(job.cache);
+
+    packer.setChunking(job.chunking);
+    packer.setMerkleTree(job.merkleTree);
+    packer.setCipher(job.cipher);
+    packer.setEncryptionOpsLimit(job.opsLimit);
+    packer.setEncryptionMemLimit(job.memLimit);
+    packer.setPassword(job.password);
+}
+
+static Json VerifyJob(Job &job, ThreadPool &pool) {
+    Unpacker unpacker;
+    unpacker.setThreadPool(&pool);
+#ifdef USE_ENCRYPTION
+    unpacker.setEncryptionOpsLimit(job.opsLimit);
+    unpacker.setEncryptionMemLimit(job.memLimit);
+    unpacker.setPassword(job.password);
+#endif
+
+    PakTypes::PakFile pakFile = Unpacker::ParsePakFile(job.output);
+    PakTypes::PakVerifyResult result = unpacker.VerifyPakFile(pakFile);
+
+    Json report = Json::MakeObject();
+    report["entriesChecked"] = result.EntriesChecked;
+    report["entriesSkipped"] = result.EntriesSkipped;
+    report["seconds"] = result.Seconds;
+    report["errors"] = Json::MakeArray();
+    for (const auto &error: result.Errors)
+        report["errors"].Append(error);
+
+    return report;
+}
+
+static double Ratio(uint64_t numerator, uint64_t denominator) {
+    return denominator > 0 ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+}
+
+static Json RunJob(Job &job, ThreadPool &pool) {
+    auto start = std::chrono::steady_clock::now();
+
+    Json report = Json::MakeObject();
+    report["name"] = job.name;
+    report["output"] = job.output;
+    report["mode"] = job.base.empty() ? "full" : "patch";
+    report["codec"] = Packer::CompressionTypeToString(job.compressionType);
+    report["status"] = "failed";
+
+    try {
+        if (job.update && IsUpToDate(job)) {
+            report["status"] = "skipped";
+            Log(job.name + ": up to date");
+            return report;
+        }
+
+        Packer packer;
+        ConfigurePacker(packer, job, pool);
+
+        fs::path outputDirectory = fs::path(job.output).parent_path();
+        if (!outputDirectory.empty())
+            fs::create_directories(outputDirectory);
+
+        bool packed = job.base.empty()
+                      ? packer.CreatePakFile(job.files, job.output, job.compressionType)
+                      : packer.CreatePatchPakFile(job.files, job.base, job.output, job.compressionType);
+        if (!packed)
+            throw std::runtime_error("Failed to compress " + job.name);
+
+        const PakTypes::PakPackStats &stats = packer.getStats();
+        report["entries"] = stats.Entries;
+        report["originalBytes"] = stats.OriginalBytes;
+        report["packedBytes"] = stats.PackedBytes;
+        report["pakBytes"] = stats.PakBytes;
+        report["compressionRatio"] = Ratio(stats.OriginalBytes, stats.PackedBytes);
+        report["pakRatio"] = Ratio(stats.PakBytes, stats.OriginalBytes);
+        if (job.chunking) {
+            report["newChunks"] = stats.NewChunks;
+            report["reusedChunks"] = stats.ReusedChunks;
+        }
+
+        Json seconds = Json::MakeObject();
+        seconds["key"] = stats.KeySeconds;
+        seconds["load"] = stats.LoadSeconds;
+        seconds["cook"] = stats.CookSeconds;
+        seconds["compress"] = stats.CompressSeconds;
+        seconds["encrypt"] = stats.EncryptSeconds;
+        seconds["write"] = stats.WriteSeconds;
+        seconds["pack"] = stats.Seconds;
+
+        report["status"] = "packed";
+
+        if (job.verify) {
+            Json verify = VerifyJob(job, pool);
+            seconds["verify"] = verify["seconds"];
+            if (!verify["errors"].AsArray().empty()) {
+                report["status"] = "failed";
+                report["error"] = "Verification failed";
+            }
+            report["verify"] = verify;
+        }
+
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        seconds["total"] = total;
+        report["seconds"] = seconds;
+        report["megabytesPerSecond"] = Ratio(stats.OriginalBytes, 1000000) / std::max(stats.Seconds, 1e-9);
+
+        char summary[256];
+        std::snprintf(summary, sizeof summary, ": %zu entries, %.2f MB -> %.2f MB in %.2f s", stats.Entries,
+                      Ratio(stats.OriginalBytes, 1000000), Ratio(stats.PakBytes, 1000000), total);
+        Log(job.name + summary);
+    } catch (const std::exception &e) {
+        report["status"] = "failed";
+        report["error"] = e.what();
+        Log(job.name + ": " + e.what());
+    }
+
+    return report;
+}
+
+// Jobs run side by side, except that a patch waits for the job that writes its base pak
+static std::vector<Json> RunJobs(std::vector<Job> &jobs, ThreadPool &pool) {
+    constexpr size_t NoBaseJob = SIZE_MAX;
+
+    std::vector<size_t> baseJobs(jobs.size(), NoBaseJob);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        for (size_t j = 0; j < jobs.size() && !jobs[i].base.empty(); j++) {
+            if (fs::path(jobs[i].base) == fs::path(jobs[j].output))
+                baseJobs[i] = j;
+        }
+    }
+
+    std::vector<std::vector<size_t>> waves;
+    std::vector<bool> scheduled(jobs.size());
+    for (size_t remaining = jobs.size(); remaining > 0; remaining -= waves.back().size()) {
+        std::vector<size_t> wave;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            if (!scheduled[i] && (baseJobs[i] == NoBaseJob || scheduled[baseJobs[i]]))
+                wave.push_back(i);
+        }
+
+        // Checked against the previous waves only, so a job never runs alongside its base
+        if (wave.empty())
+            throw std::runtime_error("Jobs use each other's output as their base pak");
+        for (size_t i: wave)
+            scheduled[i] = true;
+        waves.push_back(std::move(wave));
+    }
+
+    std::vector<Json> results(jobs.size());
+    for (const auto &wave: waves) {
+        std::vector<std::future<void>> futures;
+        futures.reserve(wave.size());
+
+        for (size_t i: wave) {
+            futures.push_back(pool.Submit([&, i]() {
+                if (baseJobs[i] != NoBaseJob && results[baseJobs[i]].Find("status")->AsString() == "failed") {
+                    results[i]["name"] = jobs[i].name;
+                    results[i]["output"] = jobs[i].output;
+                    results[i]["status"] = "failed";
+                    results[i]["error"] = "The job writing its base pak failed";
+                    Log(jobs[i].name + ": the job writing its base pak failed");
+                    return;
+                }
+                results[i] = RunJob(jobs[i], pool);
+            }));
+        }
+
+        for (auto &future: futures)
+            pool.Wait(future);
+    }
+
+    return results;
+}
+
+static std::string ReadTextFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open " + path);
+
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+static std::vector<Job> LoadJobs(const std::string &input, const Json &options, size_t &threadCount) {
+    std::vector<Job> jobs;
+
+    if (Paths::GetFileExtension(input) != ".json") {
+        Json settings = Json::MakeObject();
+        settings[fs::is_directory(input) ? "directory" : "project"] = fs::absolute(input).lexically_normal().string();
+        jobs.push_back(CreateJob(Merge(settings, options)));
+        return jobs;
+    }
+
+    if (options.Find("output") || options.Find("base"))
+        throw std::runtime_error("--output and --base apply to a single project or directory, set them per job");
+
+    Json document = Json::Parse(ReadTextFile(input));
+    fs::path root = fs::absolute(input).parent_path();
+
+    if (const Json *threads = document.Find("threads"); threads && threadCount == 0) {
+        int64_t count = threads->AsInt();
+        if (count < 1)
+            throw std::runtime_error("threads must be at least 1 in " + input);
+        threadCount = static_cast<size_t>(count);
+    }
+
+    Json defaults = Json::MakeObject();
+    if (const Json *value = document.Find("defaults")) {
+        defaults = Merge(defaults, *value);
+        ResolvePaths(defaults, root);
+    }
+
+    const Json *jobList = document.Find("jobs");
+    if (!jobList)
+        throw std::runtime_error("No jobs in " + input);
+
+    for (const auto &value: jobList->AsArray()) {
+        Json settings = Merge(Json::MakeObject(), value);
+        ResolvePaths(settings, root);
+
+        Job job = CreateJob(Merge(Merge(defaults, settings), options));
+        job.inputs.push_back(input);
+        jobs.push_back(std::move(job));
+    }
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        for (size_t j = i + 1; j < jobs.size(); j++) {
+            if (fs::path(jobs[i].output) == fs::path(jobs[j].output))
+                throw std::runtime_error("Two jobs write " + jobs[i].output);
+        }
+    }
+
+    return jobs;
+}
+
+int main(int argc, char **argv) {
+    std::string input;
+    std::string reportPath;
+    size_t threadCount = 0;
+    Json options = Json::MakeObject();
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("Missing value for " + arg);
+                return argv[++i];
+            };
+            auto path = [&]() { return fs::absolute(value()).lexically_normal().string(); };
+
+            if (arg == "-h" || arg == "--help") {
+                std::cout << Usage;
+                return 0;
+            } else if (arg == "-o" || arg == "--output") {
+                options["output"] = path();
+            } else if (arg == "-b" || arg == "--base") {
+                options["base"] = path();
+            } else if (arg == "-j" || arg == "--threads") {
+                threadCount = static_cast<size_t>(std::max(ParseInt(value(), arg), 1));
+            } else if (arg == "-c" || arg == "--codec") {
+                options["codec"] = value();
+            } else if (arg == "-l" || arg == "--level") {
+                options["level"] = ParseInt(value(), arg);
+            } else if (arg == "-r" || arg == "--rule") {
+                std::string rule = value();
+                size_t equals = rule.find('=');
+                if (equals == std::string::npos)
+                    throw std::runtime_error("Expected <ext>=<codec>[:<level>]: " + rule);
+                options["rules"][rule.substr(0, equals)] = rule.substr(equals + 1);
+            } else if (arg == "--cook") {
+                options["cook"].Append(value());
+            } else if (arg == "--cache") {
+                options["cache"] = path();
+            } else if (arg == "-u" || arg == "--update") {
+                options["update"] = true;
+            } else if (arg == "--chunking") {
+                options["chunking"] = true;
+            } else if (arg == "--merkle-tree") {
+                options["merkleTree"] = true;
+            } else if (arg == "--cipher") {
+                options["cipher"] = value();
+            } else if (arg == "--verify") {
+                options["verify"] = true;
+            } else if (arg == "--report") {
+                reportPath = value();
+            } else if (!arg.empty() && arg[0] == '-') {
+                throw std::runtime_error("Unknown option: " + arg);
+            } else if (input.empty()) {
+                input = arg;
+            } else {
+                throw std::runtime_error("Only one input can be given, use a jobs file to pack several paks");
+            }
+        }
+
+        if (input.empty()) {
+            std::cerr << Usage;
+            return 2;
+        }
+
+        std::vector<Job> jobs = LoadJobs(input, options, threadCount);
+        if (threadCount == 0)
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+        auto start = std::chrono::steady_clock::now();
+
+        // Jobs share the pool with the unpackers that read base paks and verify the output
+        ThreadPool pool(threadCount);
+        std::vector<Json> results = RunJobs(jobs, pool);
+
+        Json report = Json::MakeObject();
+        report["threads"] = threadCount;
+        report["seconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t packed = 0, skipped = 0, failed = 0;
+        uint64_t originalBytes = 0, pakBytes = 0;
+        for (auto &result: results) {
+            const std::string &status = result["status"].AsString();
+            packed += status == "packed";
+            skipped += status == "skipped";
+            failed += status == "failed";
+            if (const Json *bytes = result.Find("originalBytes"))
+                originalBytes += static_cast<uint64_t>(bytes->AsInt());
+            if (const Json *bytes = result.Find("pakBytes"))
+                pakBytes += static_cast<uint64_t>(bytes->AsInt());
+        }
+
+        report["packed"] = packed;
+        report["skipped"] = skipped;
+        report["failed"] = failed;
+        report["originalBytes"] = originalBytes;
+        report["pakBytes"] = pakBytes;
+        report["pakRatio"] = Ratio(pakBytes, originalBytes);
+        report["jobs"] = Json::MakeArray();
+        for (auto &result: results)
+            report["jobs"].Append(std::move(result));
+
+        if (reportPath.empty()) {
+            std::cout << report.Dump() << std::endl;
+        } else {
+            std::ofstream reportFile(reportPath, std::ios::binary);
+            reportFile << report.Dump() << '\n';
+            if (!reportFile)
+                throw std::runtime_error("Failed to write report: " + reportPath);
+        }
+
+        return failed > 0 ? 1 : 0;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -4,7 +4,6 @@
 #include <d3d11.h>
 #include "Gui.h"
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "External/stb_image.h"
 
 // Data
@@ -30,7 +29,12 @@ ResPacker::Gui gui;
 vector<char> mainFont;
 vector<char> iconFont;
 
-PakTypes::PakFile resFile = Unpacker::ParsePakFile("res.pak");
+PakTypes::PakFile resFile;
+
+#ifdef RES_PACKER_EMBEDDED_PAK
+extern const unsigned char EmbeddedPakData[];
+extern const size_t EmbeddedPakSize;
+#endif
 
 string resPassword = "res_packer_gui";
 
@@ -41,6 +45,20 @@ int main(int, char **) {
     const int window_width = 1280;
     const int window_height = 800;
 
+    gui.unpacker.setPassword(resPassword);
+
+    size_t encryptionOpsLimit = gui.unpacker.getEncryptionOpsLimit();
+    size_t encryptionMemLimit = gui.unpacker.getEncryptionMemLimit();
+
+    gui.unpacker.setEncryptionOpsLimit(crypto_pwhash_OPSLIMIT_MIN);
+    gui.unpacker.setEncryptionMemLimit(crypto_pwhash_MEMLIMIT_MIN);
+
+#ifdef RES_PACKER_EMBEDDED_PAK
+    auto resFileLoading = gui.unpacker.OpenAsync(EmbeddedPakData, EmbeddedPakSize, {"file1", "file2", "file3"});
+#else
+    auto resFileLoading = gui.unpacker.OpenAsync("res.pak", {"file1", "file2", "file3"});
+#endif
+
     const int windowX = (GetSystemMetrics(SM_CXSCREEN) / 2) - window_width / 2;
     const int windowY = (GetSystemMetrics(SM_CYSCREEN) / 2) - window_height / 2;
 
@@ -97,23 +115,36 @@ int main(int, char **) {
     //ImFont* font = io.Fonts->AddFontFromFileTTF("c:\\Windows\\Fonts\\ArialUni.ttf", 18.0f, NULL, io.Fonts->GetGlyphRangesJapanese());
     //IM_ASSERT(font != NULL);
 
-    gui.unpacker.setPassword(resPassword);
+    resFile = resFileLoading.get();
 
-    size_t encryptionOpsLimit = gui.unpacker.getEncryptionOpsLimit();
-    size_t encryptionMemLimit = gui.unpacker.getEncryptionMemLimit();
+    auto icon = gui.unpacker.ExtractFileToMemory(resFile, "file3");
 
-    gui.unpacker.setEncryptionOpsLimit(crypto_pwhash_OPSLIMIT_MIN);
-    gui.unpacker.setEncryptionMemLimit(crypto_pwhash_MEMLIMIT_MIN);
+    string fontAtlasEntry = FontAtlas::GetEntryName(1.0f);
+    if (!Unpacker::HasFile(resFile, fontAtlasEntry) ||
+        !FontAtlas::Load(io.Fonts, gui.unpacker.ExtractFileToMemory(resFile, fontAtlasEntry), 1.0f)) {
+        iconFont = gui.unpacker.ExtractFileToMemory(resFile, "file1");
+        mainFont = gui.unpacker.ExtractFileToMemory(resFile, "file2");
+        FontAtlas::AddFonts(io.Fonts, mainFont, iconFont, 1.0f);
+    }
 
-    iconFont = gui.unpacker.ExtractFileToMemory(resFile, "file1");
-    mainFont = gui.unpacker.ExtractFileToMemory(resFile, "file2");
-    auto icon = gui.unpacker.ExtractFileToMemory(resFile, "file3");
+    gui.font2 = io.Fonts->Fonts[1];
 
     gui.unpacker.setEncryptionOpsLimit(encryptionOpsLimit);
     gui.unpacker.setEncryptionMemLimit(encryptionMemLimit);
 
     int imageWidth, imageHeight, imageChannels;
-    unsigned char* imagePixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(&icon[0]), icon.size(), &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
+    unsigned char* imagePixels;
+    bool iconCooked = Unpacker::GetEntryInfo(resFile, "file3").CookType == PakTypes::CookType::IMAGE_RGBA;
+
+    if (iconCooked) {
+        PakTypes::CookedImageHeader iconHeader;
+        std::memcpy(&iconHeader, icon.data(), sizeof(iconHeader));
+        imageWidth = static_cast<int>(iconHeader.Width);
+        imageHeight = static_cast<int>(iconHeader.Height);
+        imagePixels = reinterpret_cast<unsigned char*>(icon.data() + sizeof(iconHeader));
+    } else {
+        imagePixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(&icon[0]), icon.size(), &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
+    }
     ID3D11Texture2D* dxTexture;
     D3D11_TEXTURE2D_DESC desc;
     ZeroMemory(&desc, sizeof(desc));
@@ -141,29 +172,12 @@ int main(int, char **) {
     gui.iconHeight = imageHeight;
     gui.iconWidth = imageWidth;
     dxTexture->Release();
-    stbi_image_free(imagePixels);
+    if (!iconCooked)
+        stbi_image_free(imagePixels);
 
     // Our state
     bool show_demo_window = false;
     ImVec4 clear_color = ImVec4(0.156f, 0.180f, 0.219, 1.0f);
-//    io.Fonts->AddFontDefault();
-    float baseFontSize = 16.0f;
-//    io.Fonts->AddFontFromFileTTF("Roboto-Medium.ttf", baseFontSize);
-    io.Fonts->AddFontFromMemoryTTF(mainFont.data(), mainFont.size(), baseFontSize);
-
-    float iconFontSize = baseFontSize * 2.0f / 3.0f;
-    static const ImWchar icons_ranges[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
-    ImFontConfig icons_config;
-    icons_config.MergeMode = true;
-    icons_config.PixelSnapH = true;
-    icons_config.GlyphMinAdvanceX = iconFontSize;
-//    io.Fonts->AddFontFromMemoryTTF((void*)fa_solid_900, sizeof(fa_solid_900), iconFontSize, &icons_config, icons_ranges);
-//    io.Fonts->AddFontFromFileTTF(FONT_ICON_FILE_NAME_FAS, 16.0f, &icons_config, icons_ranges);
-    io.Fonts->AddFontFromMemoryTTF(iconFont.data(), iconFont.size(), 16.0f, &icons_config, icons_ranges);
-
-//    io.Fonts->AddFontFromFileTTF("Roboto-Regular.ttf", 16.0f);
-//    ImFont* font2 = io.Fonts->AddFontFromFileTTF("Roboto-Medium.ttf", 28.0f);
-    gui.font2 = io.Fonts->AddFontFromMemoryTTF(mainFont.data(), mainFont.size(), 28.0f);
     string SaveFileName;
 
     // Main loop
@@ -202,6 +216,8 @@ int main(int, char **) {
         gui.RenderExtractWindow();
         gui.RenderHeaderGenerationWindow();
         gui.RenderUnpackingCompleteWindow();
+        gui.RenderFontAtlasWindow();
+        gui.RenderVerifyWindow();
 
         // Status bar code
 //        ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_MenuBar;
@@ -0,0 +1,557 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <latch>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Packer.h"
+#include "Unpacker.h"
+#include "Cipher.h"
+#include "Json.h"
+
+namespace fs = std::filesystem;
+
+enum Stage {
+    TOTAL,
+    LOOKUP,
+    IO,
+    DECRYPT,
+    DECOMPRESS,
+    VERIFY,
+    STAGE_COUNT
+};
+
+static const char *StageNames[STAGE_COUNT] = {"total", "lookup", "io", "decrypt", "decompress", "verify"};
+
+struct Sample {
+    double seconds[STAGE_COUNT];
+};
+
+struct Latency {
+    double mean;
+    double p50;
+    double p99;
+    double p999;
+    double max;
+};
+
+struct Result {
+    std::string pattern;
+    unsigned threads;
+    size_t reads;
+    uint64_t bytes;
+    double readsPerSecond;
+    double MBps;
+    Latency stages[STAGE_COUNT];
+};
+
+struct Options {
+    size_t entries = 4096;
+    size_t minSize = 512;
+    size_t maxSize = 64 * 1024;
+    bool compressed = true;
+    PakTypes::CompressionType codec = PakTypes::CompressionType::ZSTD;
+    int level = 3;
+    size_t blockSize = 256 * 1024;
+    bool encrypted = false;
+    PakTypes::CipherType cipher = PakTypes::CipherType::XCHACHA20_POLY1305;
+    bool memory = false;
+    bool verify = false;
+    std::vector<unsigned> threads;
+    size_t reads = 20000;
+    double zipf = 0.99;
+    uint64_t seed = 1;
+};
+
+static const char *Usage =
+        "Usage: res_packer_latency [options]\n"
+        "\n"
+        "Packs a synthetic pak, then times single-entry reads from it with uniform and Zipfian access patterns\n"
+        "across thread counts. Reports percentiles for the whole read and for the lookup, I/O, decrypt, decompress\n"
+        "and verify stages on their own.\n"
+        "\n"
+        "  --entries <n>              Number of entries (default: 4096)\n"
+        "  --min-size <bytes>         Smallest entry, sizes are log-uniform (default: 512)\n"
+        "  --max-size <bytes>         Largest entry (default: 65536)\n"
+        "  --codec <none|zlib|lz4|zstd>\n"
+        "                             (default: zstd)\n"
+        "  --level <n>                Compression level (default: 3)\n"
+        "  --block-size <KiB>         Seekable block size, 0 compresses entries whole (default: 256)\n"
+        "  --encrypt                  Encrypt every entry\n"
+        "  --cipher <cipher>          xchacha20-poly1305 or aes256-gcm (default: xchacha20-poly1305)\n"
+        "  --memory                   Read from the pak loaded into memory instead of from the file\n"
+        "  --verify                   Check the checksum of every entry read\n"
+        "  --threads <a,b,...>        Thread counts to run (default: powers of two up to the hardware threads)\n"
+        "  --reads <n>                Reads per thread (default: 20000)\n"
+        "  --zipf <s>                 Exponent of the Zipfian pattern (default: 0.99)\n"
+        "  --seed <n>                 Seed for the entry data and access patterns (default: 1)\n"
+        "  --work <dir>               Scratch directory for the loose files and pak (default: system temp)\n"
+        "  --csv <path>               Also write the results as CSV\n"
+        "  --json <path>              Also write the results as JSON\n"
+        "  -h, --help                 Show this message\n";
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void ParseCodec(const std::string &name, Options &options) {
+    options.compressed = name != "none";
+    if (name == "zlib")
+        options.codec = PakTypes::CompressionType::ZLIB;
+    else if (name == "lz4")
+        options.codec = PakTypes::CompressionType::LZ4;
+    else if (name == "zstd" || name == "none")
+        options.codec = PakTypes::CompressionType::ZSTD;
+    else
+        throw std::runtime_error("Unknown codec: " + name);
+}
+
+static PakTypes::CipherType ParseCipher(const std::string &name) {
+    if (name == "xchacha20-poly1305" || name == "xchacha20")
+        return PakTypes::CipherType::XCHACHA20_POLY1305;
+    if (name == "aes256-gcm" || name == "aes256gcm")
+        return PakTypes::CipherType::AES256_GCM;
+
+    throw std::runtime_error("Unknown cipher: " + name);
+}
+
+static std::vector<unsigned> ParseThreads(const std::string &value) {
+    std::vector<unsigned> threads;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        int count = std::stoi(value.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (count < 1)
+            throw std::runtime_error("Thread counts must be at least 1");
+        threads.push_back(static_cast<unsigned>(count));
+        if (comma == std::string::npos)
+            break;
+        start = comma + 1;
+    }
+    return threads;
+}
+
+static std::vector<unsigned> DefaultThreads() {
+    unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> threads;
+    for (unsigned count = 1; count < hardware; count *= 2)
+        threads.push_back(count);
+    threads.push_back(hardware);
+    return threads;
+}
+
+// Half the words come from a small palette and half are random, so entries compress roughly 2:1
+static void GenerateEntry(std::mt19937_64 &random, const std::vector<uint64_t> &palette, std::vector<char> &data,
+                          size_t size) {
+    std::uniform_int_distribution<size_t> word(0, palette.size() - 1);
+    data.clear();
+    while (data.size() < size) {
+        uint64_t value = random() & 1 ? palette[word(random)] : random();
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof value);
+    }
+    data.resize(size);
+}
+
+static std::vector<std::string> PackSyntheticPak(const Options &options, const fs::path &workDirectory,
+                                                 const fs::path &pakPath, std::string &password) {
+    fs::path directory = workDirectory / "entries";
+    fs::create_directories(directory);
+
+    std::mt19937_64 random(options.seed);
+    std::vector<uint64_t> palette(64);
+    for (auto &value: palette)
+        value = random();
+
+    std::uniform_real_distribution<double> exponent(std::log2(static_cast<double>(options.minSize)),
+                                                    std::log2(static_cast<double>(options.maxSize)));
+    std::vector<PakTypes::PakFileItem> files;
+    std::vector<std::string> packedPaths;
+    std::vector<char> data;
+    for (size_t i = 0; i < options.entries; i++) {
+        auto size = static_cast<size_t>(std::exp2(exponent(random)));
+        GenerateEntry(random, palette, data, std::clamp(size, options.minSize, options.maxSize));
+
+        std::string fileName = std::to_string(i) + ".bin";
+        fs::path path = directory / fileName;
+        std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+
+        files.push_back({
+                .name = fileName,
+                .path = path.string(),
+                .packedPath = "entries/" + fileName,
+                .size = data.size(),
+                .compressed = options.compressed,
+                .encrypted = options.encrypted
+        });
+        packedPaths.push_back(files.back().packedPath);
+    }
+
+    Packer packer;
+    packer.setZlibCompressionLevel(options.level);
+    packer.setLz4CompressionLevel(options.level);
+    packer.setZstdCompressionLevel(options.level);
+    packer.setSeekableBlockSize(options.blockSize);
+    packer.setCipher(options.cipher);
+    if (options.encrypted)
+        packer.setPassword(password);
+
+    bool packed = packer.CreatePakFile(files, pakPath.string(), options.codec);
+    fs::remove_all(directory);
+    if (!packed)
+        throw std::runtime_error("Failed to pack " + pakPath.string());
+
+    const PakTypes::PakPackStats &stats = packer.getStats();
+    std::printf("Packed %zu entries, %llu bytes to %llu (%s%s%s)\n", stats.Entries,
+                static_cast<unsigned long long>(stats.OriginalBytes),
+                static_cast<unsigned long long>(stats.PackedBytes),
+                options.compressed ? Packer::CompressionTypeToString(options.codec) : "uncompressed",
+                options.encrypted ? ", " : "",
+                options.encrypted ? Cipher::CipherTypeToString(Cipher::Select(options.cipher)) : "");
+
+    return packedPaths;
+}
+
+// Popular entries are scattered through the pak rather than packed together at the front
+static std::vector<size_t> ZipfSequence(size_t entries, double exponent, size_t count, uint64_t seed) {
+    std::mt19937_64 random(seed);
+
+    std::vector<size_t> ranked(entries);
+    std::iota(ranked.begin(), ranked.end(), size_t{0});
+    std::shuffle(ranked.begin(), ranked.end(), random);
+
+    std::vector<double> cumulative(entries);
+    double total = 0.0;
+    for (size_t rank = 0; rank < entries; rank++) {
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+        cumulative[rank] = total;
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<size_t> sequence(count);
+    for (auto &index: sequence) {
+        size_t rank = std::upper_bound(cumulative.begin(), cumulative.end(), uniform(random)) - cumulative.begin();
+        index = ranked[std::min(rank, entries - 1)];
+    }
+    return sequence;
+}
+
+static std::vector<size_t> UniformSequence(size_t entries, size_t count, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::uniform_int_distribution<size_t> entry(0, entries - 1);
+    std::vector<size_t> sequence(count);
+    for (auto &index: sequence)
+        index = entry(random);
+    return sequence;
+}
+
+static Latency Summarize(std::vector<double> &seconds) {
+    Latency latency{};
+    if (seconds.empty())
+        return latency;
+
+    std::sort(seconds.begin(), seconds.end());
+    auto percentile = [&seconds](double fraction) {
+        auto rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(seconds.size())));
+        return seconds[std::clamp<size_t>(rank, 1, seconds.size()) - 1] * 1e6;
+    };
+
+    latency.mean = std::accumulate(seconds.begin(), seconds.end(), 0.0) / static_cast<double>(seconds.size()) * 1e6;
+    latency.p50 = percentile(0.50);
+    latency.p99 = percentile(0.99);
+    latency.p999 = percentile(0.999);
+    latency.max = seconds.back() * 1e6;
+    return latency;
+}
+
+// Each thread gets its own Unpacker and PakFile, since a file-backed PakFile shares one stream position
+static Result Run(const Options &options, const std::string &pattern, unsigned threads, const fs::path &pakPath,
+                  const std::vector<char> &pakData, const std::vector<std::string> &packedPaths,
+                  std::string &password) {
+    std::vector<std::vector<Sample>> samples(threads);
+    std::vector<uint64_t> bytes(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    std::latch ready(threads + 1);
+
+    auto worker = [&](unsigned thread) {
+        bool arrived = false;
+        try {
+            uint64_t seed = options.seed * 1000003 + thread;
+            std::vector<size_t> sequence = pattern == "zipf"
+                                           ? ZipfSequence(packedPaths.size(), options.zipf, options.reads, seed)
+                                           : UniformSequence(packedPaths.size(), options.reads, seed);
+
+            Unpacker unpacker;
+            unpacker.setVerifyChecksums(options.verify);
+            if (options.encrypted)
+                unpacker.setPassword(password);
+
+            PakTypes::PakFile pakFile = options.memory
+                                        ? Unpacker::ParsePakMemory(pakData.data(), pakData.size())
+                                        : Unpacker::ParsePakFile(pakPath.string());
+
+            std::vector<std::byte> buffer(options.maxSize);
+
+            // Derives the key and warms this thread's decompression context outside the timed reads
+            for (size_t i = 0; i < std::min<size_t>(sequence.size(), 64); i++)
+                unpacker.ExtractFileToMemory(pakFile, packedPaths[sequence[i]], std::span<std::byte>(buffer));
+
+            samples[thread].reserve(sequence.size());
+            arrived = true;
+            ready.arrive_and_wait();
+
+            for (size_t index: sequence) {
+                PakTypes::PakReadTimings before = Unpacker::GetReadTimings();
+                auto start = std::chrono::steady_clock::now();
+                bytes[thread] += unpacker.ExtractFileToMemory(pakFile, packedPaths[index],
+                                                              std::span<std::byte>(buffer));
+                double seconds = SecondsSince(start);
+                PakTypes::PakReadTimings after = Unpacker::GetReadTimings();
+
+                samples[thread].push_back({{
+                        seconds,
+                        after.LookupSeconds - before.LookupSeconds,
+                        after.IoSeconds - before.IoSeconds,
+                        after.DecryptSeconds - before.DecryptSeconds,
+                        after.DecompressSeconds - before.DecompressSeconds,
+                        after.VerifySeconds - before.VerifySeconds
+                }});
+            }
+        } catch (...) {
+            errors[thread] = std::current_exception();
+            if (!arrived)
+                ready.count_down();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned thread = 0; thread < threads; thread++)
+        workers.emplace_back(worker, thread);
+
+    ready.arrive_and_wait();
+    auto start = std::chrono::steady_clock::now();
+    for (auto &thread: workers)
+        thread.join();
+    double seconds = SecondsSince(start);
+
+    for (const auto &error: errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    Result result{};
+    result.pattern = pattern;
+    result.threads = threads;
+    result.bytes = std::accumulate(bytes.begin(), bytes.end(), uint64_t{0});
+
+    std::vector<double> values;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        values.clear();
+        for (const auto &threadSamples: samples) {
+            for (const auto &sample: threadSamples)
+                values.push_back(sample.seconds[stage]);
+        }
+        result.stages[stage] = Summarize(values);
+    }
+
+    result.reads = values.size();
+    result.readsPerSecond = seconds > 0.0 ? static_cast<double>(result.reads) / seconds : 0.0;
+    result.MBps = seconds > 0.0 ? static_cast<double>(result.bytes) / 1e6 / seconds : 0.0;
+    return result;
+}
+
+static void PrintResult(const Result &result) {
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Latency &latency = result.stages[stage];
+        if (stage != TOTAL && latency.max == 0.0)
+            continue;
+
+        if (stage == TOTAL) {
+            std::printf("%-8s %7u %12.0f %9.1f ", result.pattern.c_str(), result.threads, result.readsPerSecond,
+                        result.MBps);
+        } else {
+            std::printf("%-8s %7s %12s %9s ", "", "", "", "");
+        }
+        std::printf("%-10s %9.2f %9.2f %9.2f %9.2f %10.2f\n", StageNames[stage], latency.mean, latency.p50,
+                    latency.p99, latency.p999, latency.max);
+    }
+    std::fflush(stdout);
+}
+
+static void WriteCsv(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream csv(path, std::ios::binary);
+    csv << "pattern,threads,reads,reads_per_second,mbps,stage,mean_us,p50_us,p99_us,p999_us,max_us\n";
+
+    for (const auto &result: results) {
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            const Latency &latency = result.stages[stage];
+            char line[512];
+            std::snprintf(line, sizeof line, "%s,%u,%zu,%.1f,%.2f,%s,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                          result.pattern.c_str(), result.threads, result.reads, result.readsPerSecond, result.MBps,
+                          StageNames[stage], latency.mean, latency.p50, latency.p99, latency.p999, latency.max);
+            csv << line;
+        }
+    }
+
+    if (!csv)
+        throw std::runtime_error("Failed to write " + path);
+}
+
+static void WriteJson(const std::string &path, const std::vector<Result> &results, const Options &options) {
+    Json report = Json::MakeObject();
+    report["timestamp"] = static_cast<int64_t>(std::time(nullptr));
+    report["entries"] = options.entries;
+    report["minSize"] = options.minSize;
+    report["maxSize"] = options.maxSize;
+    report["codec"] = options.compressed ? Packer::CompressionTypeToString(options.codec) : "none";
+    report["level"] = options.level;
+    report["blockSize"] = options.blockSize;
+    report["encrypted"] = options.encrypted;
+    if (options.encrypted)
+        report["cipher"] = Cipher::CipherTypeToString(Cipher::Select(options.cipher));
+    report["memory"] = options.memory;
+    report["verify"] = options.verify;
+    report["zipf"] = options.zipf;
+    report["results"] = Json::MakeArray();
+
+    for (const auto &result: results) {
+        Json row = Json::MakeObject();
+        row["pattern"] = result.pattern;
+        row["threads"] = result.threads;
+        row["reads"] = result.reads;
+        row["readsPerSecond"] = result.readsPerSecond;
+        row["MBps"] = result.MBps;
+
+        Json stages = Json::MakeObject();
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            const Latency &latency = result.stages[stage];
+            Json microseconds = Json::MakeObject();
+            microseconds["mean"] = latency.mean;
+            microseconds["p50"] = latency.p50;
+            microseconds["p99"] = latency.p99;
+            microseconds["p999"] = latency.p999;
+            microseconds["max"] = latency.max;
+            stages[StageNames[stage]] = microseconds;
+        }
+        row["stagesUs"] = stages;
+        report["results"].Append(row);
+    }
+
+    std::ofstream json(path, std::ios::binary);
+    json << report.Dump() << '\n';
+    if (!json)
+        throw std::runtime_error("Failed to write " + path);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    fs::path workDirectory = fs::temp_directory_path() / "res_packer_latency";
+    std::string csvPath, jsonPath;
+    std::string password = "res_packer_latency";
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("Missing value for " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "-h" || arg == "--help") {
+                std::cout << Usage;
+                return 0;
+            } else if (arg == "--entries") {
+                options.entries = std::stoull(value());
+            } else if (arg == "--min-size") {
+                options.minSize = std::stoull(value());
+            } else if (arg == "--max-size") {
+                options.maxSize = std::stoull(value());
+            } else if (arg == "--codec") {
+                ParseCodec(value(), options);
+            } else if (arg == "--level") {
+                options.level = std::stoi(value());
+            } else if (arg == "--block-size") {
+                options.blockSize = std::stoull(value()) * 1024;
+            } else if (arg == "--encrypt") {
+                options.encrypted = true;
+            } else if (arg == "--cipher") {
+                options.cipher = ParseCipher(value());
+            } else if (arg == "--memory") {
+                options.memory = true;
+            } else if (arg == "--verify") {
+                options.verify = true;
+            } else if (arg == "--threads") {
+                options.threads = ParseThreads(value());
+            } else if (arg == "--reads") {
+                options.reads = std::stoull(value());
+            } else if (arg == "--zipf") {
+                options.zipf = std::stod(value());
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value());
+            } else if (arg == "--work") {
+                workDirectory = value();
+            } else if (arg == "--csv") {
+                csvPath = value();
+            } else if (arg == "--json") {
+                jsonPath = value();
+            } else {
+                throw std::runtime_error("Unknown option: " + arg);
+            }
+        }
+
+        if (options.entries == 0 || options.reads == 0)
+            throw std::runtime_error("--entries and --reads must be at least 1");
+        if (options.minSize == 0 || options.minSize > options.maxSize)
+            throw std::runtime_error("--min-size must be between 1 and --max-size");
+        if (options.threads.empty())
+            options.threads = DefaultThreads();
+
+        fs::create_directories(workDirectory);
+        fs::path pakPath = workDirectory / "latency.pak";
+        std::vector<std::string> packedPaths = PackSyntheticPak(options, workDirectory, pakPath, password);
+
+        std::vector<char> pakData;
+        if (options.memory) {
+            std::ifstream pak(pakPath, std::ios::binary);
+            pakData.resize(fs::file_size(pakPath));
+            if (!pak.read(pakData.data(), static_cast<std::streamsize>(pakData.size())))
+                throw std::runtime_error("Failed to read " + pakPath.string());
+        }
+
+        std::printf("%-8s %7s %12s %9s %-10s %9s %9s %9s %9s %10s\n", "pattern", "threads", "reads/s", "MB/s",
+                    "stage", "mean us", "p50 us", "p99 us", "p99.9 us", "max us");
+
+        Unpacker::setCollectReadTimings(true);
+
+        std::vector<Result> results;
+        for (const char *pattern: {"uniform", "zipf"}) {
+            for (unsigned threads: options.threads) {
+                results.push_back(Run(options, pattern, threads, pakPath, pakData, packedPaths, password));
+                PrintResult(results.back());
+            }
+        }
+
+        fs::remove(pakPath);
+
+        if (!csvPath.empty())
+            WriteCsv(csvPath, results);
+        if (!jsonPath.empty())
+            WriteJson(jsonPath, results, options);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
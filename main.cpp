@@ -5,7 +5,6 @@
 #include <GLFW/glfw3.h>
 #include "Gui.h"
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "External/stb_image.h"
 
 static void glfw_error_callback(int error, const char* description)
@@ -18,7 +17,12 @@ ResPacker::Gui gui;
 vector<char> mainFont;
 vector<char> iconFont;
 
-PakTypes::PakFile resFile = Unpacker::ParsePakFile("res.pak");
+PakTypes::PakFile resFile;
+
+#ifdef RES_PACKER_EMBEDDED_PAK
+extern const unsigned char EmbeddedPakData[];
+extern const size_t EmbeddedPakSize;
+#endif
 
 string resPassword = "res_packer_gui";
 
@@ -35,6 +39,20 @@ int main(int, char**)
     const int window_width = 1280;
     const int window_height = 720;
 
+    gui.unpacker.setPassword(resPassword);
+
+    size_t encryptionOpsLimit = gui.unpacker.getEncryptionOpsLimit();
+    size_t encryptionMemLimit = gui.unpacker.getEncryptionMemLimit();
+
+    gui.unpacker.setEncryptionOpsLimit(crypto_pwhash_OPSLIMIT_MIN);
+    gui.unpacker.setEncryptionMemLimit(crypto_pwhash_MEMLIMIT_MIN);
+
+#ifdef RES_PACKER_EMBEDDED_PAK
+    auto resFileLoading = gui.unpacker.OpenAsync(EmbeddedPakData, EmbeddedPakSize, {"file1", "file2", "file3"});
+#else
+    auto resFileLoading = gui.unpacker.OpenAsync("res.pak", {"file1", "file2", "file3"});
+#endif
+
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit())
         return 1;
@@ -57,6 +75,10 @@ int main(int, char**)
     glfwMakeContextCurrent(gui.window);
     glfwSwapInterval(1); // Enable vsync
 
+    glClearColor(0.156f, 0.180f, 0.219f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glfwSwapBuffers(gui.window);
+
     glfwSetDropCallback(gui.window, drop_callback);
     glfwSetWindowSizeCallback(gui.window, window_size_callback);
     glfwSetWindowContentScaleCallback(gui.window, window_content_scale_callback);
@@ -114,24 +136,37 @@ int main(int, char**)
     //IM_ASSERT(font != nullptr);
 //    io.Fonts->AddFontFromFileTTF("Roboto-Medium.ttf", 16.0f * scaleX);
 
-    gui.unpacker.setPassword(resPassword);
+    resFile = resFileLoading.get();
 
-    size_t encryptionOpsLimit = gui.unpacker.getEncryptionOpsLimit();
-    size_t encryptionMemLimit = gui.unpacker.getEncryptionMemLimit();
+    auto icon = gui.unpacker.ExtractFileToMemory(resFile, "file3");
 
-    gui.unpacker.setEncryptionOpsLimit(crypto_pwhash_OPSLIMIT_MIN);
-    gui.unpacker.setEncryptionMemLimit(crypto_pwhash_MEMLIMIT_MIN);
+    string fontAtlasEntry = FontAtlas::GetEntryName(scaleX);
+    if (!Unpacker::HasFile(resFile, fontAtlasEntry) ||
+        !FontAtlas::Load(io.Fonts, gui.unpacker.ExtractFileToMemory(resFile, fontAtlasEntry), scaleX)) {
+        iconFont = gui.unpacker.ExtractFileToMemory(resFile, "file1");
+        mainFont = gui.unpacker.ExtractFileToMemory(resFile, "file2");
+        FontAtlas::AddFonts(io.Fonts, mainFont, iconFont, scaleX);
+    }
 
-    iconFont = gui.unpacker.ExtractFileToMemory(resFile, "file1");
-    mainFont = gui.unpacker.ExtractFileToMemory(resFile, "file2");
-    auto icon = gui.unpacker.ExtractFileToMemory(resFile, "file3");
+    gui.font2 = io.Fonts->Fonts[1];
 
     gui.unpacker.setEncryptionOpsLimit(encryptionOpsLimit);
     gui.unpacker.setEncryptionMemLimit(encryptionMemLimit);
 
     {
         int imageWidth, imageHeight, imageChannels;
-        unsigned char* imagePixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(&icon[0]), icon.size(), &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
+        unsigned char* imagePixels;
+        bool iconCooked = Unpacker::GetEntryInfo(resFile, "file3").CookType == PakTypes::CookType::IMAGE_RGBA;
+
+        if (iconCooked) {
+            PakTypes::CookedImageHeader iconHeader;
+            std::memcpy(&iconHeader, icon.data(), sizeof(iconHeader));
+            imageWidth = static_cast<int>(iconHeader.Width);
+            imageHeight = static_cast<int>(iconHeader.Height);
+            imagePixels = reinterpret_cast<unsigned char*>(icon.data() + sizeof(iconHeader));
+        } else {
+            imagePixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(&icon[0]), icon.size(), &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
+        }
 
         GLFWimage appIcon(imageWidth, imageHeight, imagePixels);
         glfwSetWindowIcon(gui.window, 1, &appIcon);
@@ -147,25 +182,14 @@ int main(int, char**)
 #endif
 
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imageWidth, imageHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, imagePixels);
-        stbi_image_free(imagePixels);
+        if (!iconCooked)
+            stbi_image_free(imagePixels);
 
         gui.iconTexture = image_texture;
         gui.iconHeight = imageHeight;
         gui.iconWidth = imageWidth;
     }
 
-    float baseFontSize = 16.0f;
-    io.Fonts->AddFontFromMemoryTTF(mainFont.data(), mainFont.size(), baseFontSize * scaleX);
-
-    float iconFontSize = baseFontSize * 2.0f / 3.0f;
-    static const ImWchar icons_ranges[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
-    ImFontConfig icons_config;
-    icons_config.MergeMode = true;
-    icons_config.PixelSnapH = true;
-    icons_config.GlyphMinAdvanceX = iconFontSize;
-    io.Fonts->AddFontFromMemoryTTF(iconFont.data(), iconFont.size(), baseFontSize * scaleX, &icons_config, icons_ranges);
-
-    gui.font2 = io.Fonts->AddFontFromMemoryTTF(mainFont.data(), mainFont.size(), 28.0f * scaleX);
     string SaveFileName;
 
     // Our state
@@ -210,6 +234,8 @@ int main(int, char**)
             gui.RenderExtractWindow();
             gui.RenderHeaderGenerationWindow();
             gui.RenderUnpackingCompleteWindow();
+            gui.RenderFontAtlasWindow();
+            gui.RenderVerifyWindow();
         }
 
         // Rendering